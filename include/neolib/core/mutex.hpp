@@ -76,6 +76,34 @@ namespace neolib
         Subject* iSubject;
     };
 
+    // a non-recursive spinlock small enough to embed in every instance of a frequently
+    // instantiated class; deliberately not an i_lockable to avoid the vtable pointer
+    class spinlock
+    {
+    public:
+        spinlock() :
+            iState{}
+        {
+        }
+    public:
+        void lock() noexcept
+        {
+            while (iState.test_and_set(std::memory_order_acquire))
+                iState.wait(true, std::memory_order_relaxed);
+        }
+        void unlock() noexcept
+        {
+            iState.clear(std::memory_order_release);
+            iState.notify_one();
+        }
+        bool try_lock() noexcept
+        {
+            return !iState.test_and_set(std::memory_order_acquire);
+        }
+    private:
+        std::atomic_flag iState;
+    };
+
     class alignas(BOOST_LOCKFREE_CACHELINE_BYTES) recursive_spinlock : public i_lockable
     {
     public:
@@ -0,0 +1,332 @@
+// archetype_storage.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <tuple>
+#include <vector>
+#include <neolib/task/parallel_algorithm.hpp>
+#include <neolib/ecs/ecs_ids.hpp>
+#include <neolib/ecs/i_ecs.hpp>
+#include <neolib/ecs/i_archetype_storage.hpp>
+#include <neolib/ecs/entity_archetype.hpp>
+#include <neolib/ecs/component.hpp>
+#include <neolib/ecs/sparse_index.hpp>
+
+namespace neolib::ecs
+{
+    // Opt-in alternative to per-component storage: entities created with a chunked_archetype have their
+    // components stored together in fixed-size chunks (one column per component) rather than in each
+    // component's own vector, so a system touching several components walks memory linearly instead of
+    // looking each component up through its reverse index. Chunks are kept dense: destroying an entity
+    // moves the last entity of the last chunk into its place.
+    template <typename... ComponentData>
+    class archetype_storage : public i_archetype_storage
+    {
+        typedef archetype_storage<ComponentData...> self_type;
+    public:
+        using i_archetype_storage::entity_not_found;
+        using i_archetype_storage::component_not_found;
+        using i_archetype_storage::invalid_data;
+    public:
+        static constexpr std::size_t kChunkBytes = 16u * 1024u;
+        static constexpr std::size_t kChunkCapacity = std::max<std::size_t>(1u, kChunkBytes / (sizeof(entity_id) + (sizeof(ComponentData) + ...)));
+    private:
+        struct chunk
+        {
+            std::vector<entity_id> entities;
+            std::tuple<std::vector<ComponentData>...> columns;
+
+            chunk()
+            {
+                entities.reserve(kChunkCapacity);
+                (std::get<std::vector<ComponentData>>(columns).reserve(kChunkCapacity), ...);
+            }
+            std::size_t size() const
+            {
+                return entities.size();
+            }
+        };
+        typedef std::vector<std::unique_ptr<chunk>> chunks_t;
+        struct location
+        {
+            std::size_t chunk;
+            std::size_t row;
+
+            bool operator==(location const&) const = default;
+        };
+        typedef paged_sparse_index<location> locations_t;
+        static constexpr std::size_t invalid = ~std::size_t{};
+    public:
+        static_assert(sizeof...(ComponentData) > 0, "neolib::ecs::archetype_storage: no components");
+        static_assert((std::is_same_v<ComponentData, ecs_data_type_t<ComponentData>> && ...), "neolib::ecs::archetype_storage: components must be plain data types");
+    public:
+        archetype_storage(i_ecs& aEcs, const entity_archetype_id& aArchetypeId) :
+            iEcs{ aEcs }, iId{ aArchetypeId }, iLocations{ location{ invalid, invalid } }, iEntityCount{ 0u }
+        {
+        }
+    public:
+        i_ecs& ecs() const final
+        {
+            return iEcs;
+        }
+        const entity_archetype_id& id() const final
+        {
+            return iId;
+        }
+    public:
+        component_mutex<self_type>& mutex() const final
+        {
+            return iMutex;
+        }
+    public:
+        bool has_component(component_id aComponentId) const final
+        {
+            return ((aComponentId == ComponentData::meta::id()) || ...);
+        }
+        std::size_t entity_count() const final
+        {
+            return iEntityCount;
+        }
+        bool has_entity_no_lock(entity_id aEntity) const final
+        {
+            return location_no_lock(aEntity).chunk != invalid;
+        }
+        bool has_entity(entity_id aEntity) const final
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            return has_entity_no_lock(aEntity);
+        }
+        void destroy_entity(entity_id aEntity) final
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            auto const where = location_no_lock(aEntity);
+            if (where.chunk == invalid)
+                throw entity_not_found();
+            auto& target = *iChunks[where.chunk];
+            (free_handles<ComponentData>(std::get<std::vector<ComponentData>>(target.columns)[where.row]), ...);
+            auto& last = *iChunks.back();
+            auto const lastRow = last.size() - 1u;
+            if (&target != &last || where.row != lastRow)
+            {
+                auto const movedEntity = last.entities[lastRow];
+                target.entities[where.row] = movedEntity;
+                ((std::get<std::vector<ComponentData>>(target.columns)[where.row] = std::move(std::get<std::vector<ComponentData>>(last.columns)[lastRow])), ...);
+                iLocations.set(movedEntity, where);
+            }
+            last.entities.pop_back();
+            (std::get<std::vector<ComponentData>>(last.columns).pop_back(), ...);
+            if (last.size() == 0u)
+                iChunks.pop_back();
+            iLocations.reset(aEntity);
+            --iEntityCount;
+        }
+    public:
+        void add_entity(entity_id aEntity) final
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            if (!has_entity_no_lock(aEntity))
+                add_row(aEntity);
+        }
+        void populate_component(entity_id aEntity, component_id aComponentId, const void* aComponentData, std::size_t aComponentDataSize) final
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            if (!has_component(aComponentId))
+                throw component_not_found();
+            bool valid = false;
+            ((aComponentId == ComponentData::meta::id() ? void(valid = (aComponentData != nullptr && aComponentDataSize == sizeof(ComponentData))) : void()), ...);
+            if (!valid)
+                throw invalid_data();
+            if (!has_entity_no_lock(aEntity))
+                add_row(aEntity);
+            ((aComponentId == ComponentData::meta::id() ? void(assign(aEntity, *static_cast<const ComponentData*>(aComponentData))) : void()), ...);
+        }
+        using i_archetype_storage::populate_component;
+    public:
+        std::size_t chunk_capacity() const final
+        {
+            return kChunkCapacity;
+        }
+        std::size_t chunk_count() const final
+        {
+            return iChunks.size();
+        }
+        std::size_t chunk_size(std::size_t aChunk) const final
+        {
+            return iChunks[aChunk]->size();
+        }
+        const entity_id* chunk_entities(std::size_t aChunk) const final
+        {
+            return iChunks[aChunk]->entities.data();
+        }
+        const void* chunk_column(std::size_t aChunk, component_id aComponentId) const final
+        {
+            const void* result = nullptr;
+            auto const& columns = iChunks[aChunk]->columns;
+            ((aComponentId == ComponentData::meta::id() ? void(result = std::get<std::vector<ComponentData>>(columns).data()) : void()), ...);
+            if (result == nullptr)
+                throw component_not_found();
+            return result;
+        }
+        void* chunk_column(std::size_t aChunk, component_id aComponentId) final
+        {
+            return const_cast<void*>(to_const(*this).chunk_column(aChunk, aComponentId));
+        }
+    public:
+        template <typename Data>
+        const Data& entity_record_no_lock(entity_id aEntity) const
+        {
+            auto const where = location_no_lock(aEntity);
+            if (where.chunk == invalid)
+                throw entity_not_found();
+            return std::get<std::vector<Data>>(iChunks[where.chunk]->columns)[where.row];
+        }
+        template <typename Data>
+        Data& entity_record_no_lock(entity_id aEntity)
+        {
+            return const_cast<Data&>(to_const(*this).template entity_record_no_lock<Data>(aEntity));
+        }
+        template <typename Data>
+        const Data& entity_record(entity_id aEntity) const
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            return entity_record_no_lock<Data>(aEntity);
+        }
+        template <typename Data>
+        Data& entity_record(entity_id aEntity)
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            return entity_record_no_lock<Data>(aEntity);
+        }
+        // components not supplied are value-initialized
+        template <typename... Data>
+        void populate(entity_id aEntity, Data&&... aComponentData)
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            if (!has_entity_no_lock(aEntity))
+                add_row(aEntity);
+            (assign(aEntity, std::forward<Data>(aComponentData)), ...);
+        }
+    public:
+        // aCallable(entity_id, ComponentData&...) is called for each entity, chunk by chunk
+        template <typename Callable>
+        void apply(const Callable& aCallable)
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            for (auto& c : iChunks)
+                apply_chunk(*c, aCallable);
+        }
+        // aCallable(std::span<const entity_id>, std::span<ComponentData>...) is called for each chunk
+        template <typename Callable>
+        void apply_chunks(const Callable& aCallable)
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            for (auto& c : iChunks)
+                aCallable(std::span<const entity_id>{ c->entities }, std::span<ComponentData>{ std::get<std::vector<ComponentData>>(c->columns) }...);
+        }
+        // as apply() but chunks are distributed across the ECS thread pool
+        template <typename Callable>
+        void parallel_apply(const Callable& aCallable)
+        {
+            std::scoped_lock<component_mutex<self_type>> lock{ mutex() };
+            neolib::parallel_for(ecs().thread_pool(), iChunks, [&](std::unique_ptr<chunk>& aChunk) { apply_chunk(*aChunk, aCallable); }, 1u);
+        }
+    private:
+        location location_no_lock(entity_id aEntity) const
+        {
+            return iLocations[aEntity];
+        }
+        void add_row(entity_id aEntity)
+        {
+            if (iChunks.empty() || iChunks.back()->size() == kChunkCapacity)
+                iChunks.push_back(std::make_unique<chunk>());
+            auto& target = *iChunks.back();
+            // columns have been reserved to chunk capacity so none of these can reallocate
+            target.entities.push_back(aEntity);
+            (std::get<std::vector<ComponentData>>(target.columns).emplace_back(), ...);
+            iLocations.set(aEntity, location{ iChunks.size() - 1u, target.size() - 1u });
+            ++iEntityCount;
+        }
+        template <typename T>
+        void assign(entity_id aEntity, T&& aComponentData)
+        {
+            entity_record_no_lock<ecs_data_type_t<T>>(aEntity) = std::forward<T>(aComponentData);
+        }
+        template <typename Data>
+        void free_handles(Data& aData)
+        {
+            if constexpr (Data::meta::has_handles)
+                Data::meta::free_handles(aData, ecs());
+        }
+        template <typename Callable>
+        static void apply_chunk(chunk& aChunk, const Callable& aCallable)
+        {
+            auto const size = aChunk.size();
+            auto columns = std::make_tuple(std::get<std::vector<ComponentData>>(aChunk.columns).data()...);
+            for (std::size_t row = 0u; row < size; ++row)
+                aCallable(aChunk.entities[row], std::get<ComponentData*>(columns)[row]...);
+        }
+    private:
+        mutable component_mutex<self_type> iMutex;
+        i_ecs& iEcs;
+        entity_archetype_id iId;
+        chunks_t iChunks;
+        locations_t iLocations;
+        std::size_t iEntityCount;
+    };
+
+    // An archetype whose entities are kept in an archetype_storage; create_entity() with such an
+    // archetype populates the storage instead of the individual components.
+    template <typename... ComponentData>
+    class chunked_archetype : public entity_archetype
+    {
+    public:
+        typedef neolib::ecs::archetype_storage<ComponentData...> storage_type;
+    public:
+        chunked_archetype(const entity_archetype_id& aId, const std::string& aName) :
+            entity_archetype{ aId, aName, { ComponentData::meta::id()... } }
+        {
+        }
+        chunked_archetype(const std::string& aName) :
+            entity_archetype{ aName, { ComponentData::meta::id()... } }
+        {
+        }
+    };
+}
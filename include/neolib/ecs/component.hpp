@@ -41,8 +41,9 @@
 #include <unordered_map>
 #include <string>
 #include <neolib/core/intrusive_sort.hpp>
-#include <neolib/task/thread_pool.hpp>
+#include <neolib/task/parallel_algorithm.hpp>
 #include <neolib/ecs/ecs_ids.hpp>
+#include <neolib/ecs/sparse_index.hpp>
 #include <neolib/ecs/i_ecs.hpp>
 
 namespace neolib::ecs
@@ -220,7 +221,7 @@ namespace neolib::ecs
         typedef typename base_type::component_data_t component_data_t;
         typedef std::vector<entity_id> component_data_entities_t;
         typedef typename component_data_t::size_type reverse_index_t;
-        typedef std::vector<reverse_index_t> reverse_indices_t;
+        typedef paged_sparse_index<reverse_index_t> reverse_indices_t;
     public:
         typedef std::unique_ptr<self_type> snapshot_ptr;
         class scoped_snapshot
@@ -253,6 +254,7 @@ namespace neolib::ecs
     public:
         component(i_ecs& aEcs) : 
             base_type{ aEcs },
+            iReverseIndices{ invalid },
             iHaveSnapshot{ false },
             iUsingSnapshot{ 0u }
         {
@@ -313,9 +315,7 @@ namespace neolib::ecs
         }
         reverse_index_t reverse_index_no_lock(entity_id aEntity) const
         {
-            if (reverse_indices().size() > aEntity)
-                return reverse_indices()[aEntity];
-            return invalid;
+            return reverse_indices()[aEntity];
         }
         bool has_entity_record_no_lock(entity_id aEntity) const final
         {
@@ -367,8 +367,10 @@ namespace neolib::ecs
             auto tailEntity = entities().back();
             std::swap(entities()[reverseIndex], entities().back());
             entities().pop_back();
-            reverse_indices()[tailEntity] = reverseIndex;
-            reverse_indices()[aEntity] = invalid;
+            reverse_indices().set(tailEntity, reverseIndex);
+            reverse_indices().reset(aEntity);
+            for (auto observer : iObservers)
+                observer->entity_record_removed(*this, aEntity);
             if (have_snapshot())
             {
                 auto ss = snapshot();
@@ -396,6 +398,17 @@ namespace neolib::ecs
             else
                 return &do_populate(aEntity, value_type{}); // empty optional
         }
+    public:
+        void add_observer(i_component_observer& aObserver) final
+        {
+            std::scoped_lock<component_mutex<Data>> lock{ mutex() };
+            iObservers.push_back(&aObserver);
+        }
+        void remove_observer(i_component_observer& aObserver) final
+        {
+            std::scoped_lock<component_mutex<Data>> lock{ mutex() };
+            std::erase(iObservers, &aObserver);
+        }
     public:
         bool have_snapshot() const
         {
@@ -432,9 +445,9 @@ namespace neolib::ecs
                     auto& rhsEntity = entities()[rhsIndex];
                     std::swap(lhsEntity, rhsEntity);
                     if (lhsEntity != invalid)
-                        reverse_indices()[lhsEntity] = lhsIndex;
+                        reverse_indices().set(lhsEntity, lhsIndex);
                     if (rhsEntity != invalid)
-                        reverse_indices()[rhsEntity] = rhsIndex;
+                        reverse_indices().set(rhsEntity, rhsIndex);
                 }, aComparator);
         }
     public:
@@ -472,15 +485,15 @@ namespace neolib::ecs
             }
             try
             {
-                if (reverse_indices().size() <= aEntity)
-                    reverse_indices().resize(aEntity + 1, invalid);
-                reverse_indices()[aEntity] = reverseIndex;
+                reverse_indices().set(aEntity, reverseIndex);
             }
             catch (...)
             {
                 entities()[reverseIndex] = null_entity;
                 throw;
             }
+            for (auto observer : iObservers)
+                observer->entity_record_added(*this, aEntity);
             return base_type::component_data()[reverseIndex];
         }
         template <typename T>
@@ -494,6 +507,7 @@ namespace neolib::ecs
     private:
         component_data_entities_t iEntities;
         reverse_indices_t iReverseIndices;
+        std::vector<i_component_observer*> iObservers;
         mutable std::atomic<bool> iHaveSnapshot;
         mutable std::atomic<uint32_t> iUsingSnapshot;
         mutable snapshot_ptr iSnapshot;
@@ -37,13 +37,17 @@
 
 #include <neolib/neolib.hpp>
 #include <atomic>
+#include <set>
 #include <neolib/core/mutex.hpp>
 #include <neolib/task/async_task.hpp>
 #include <neolib/task/timer.hpp>
 #include <neolib/app/object.hpp>
 #include <neolib/ecs/i_ecs.hpp>
 #include <neolib/ecs/component.hpp>
+#include <neolib/ecs/archetype_storage.hpp>
+#include <neolib/ecs/view.hpp>
 #include <neolib/ecs/system.hpp>
+#include <neolib/ecs/system_scheduler.hpp>
 
 namespace neolib::ecs
 {
@@ -63,9 +67,13 @@ namespace neolib::ecs
     public:
         neolib::recursive_spinlock& mutex() const final;
         neolib::thread_pool& thread_pool() const final;
+        neolib::thread_placement system_thread_placement() const final;
+        void set_system_thread_placement(neolib::thread_placement const& aPlacement) final;
+        std::size_t place_system_thread(neolib::thread& aSystemThread) final;
+        void release_system_thread(std::size_t aPlacementIndex) final;
     public:
         ecs_flags flags() const final;
-        entity_id create_entity(const entity_archetype_id& aArchetypeId) final;
+        entity_id create_entity(const entity_archetype_id& aArchetypeId, bool aNotify = true) final;
         void async_create_entity(const std::function<void()>& aCreator) final;
         void commit_async_entity_creation() final;
         void destroy_entity(entity_id aEntityId, bool aNotify = true) override;
@@ -79,6 +87,8 @@ namespace neolib::ecs
     public:
         const archetype_registry_t& archetypes() const final;
         archetype_registry_t& archetypes() final;
+        const archetype_storages_t& archetype_storages() const final;
+        archetype_storages_t& archetype_storages() final;
         const component_factories_t& component_factories() const final;
         component_factories_t& component_factories() final;
         const components_t& components() const final;
@@ -94,6 +104,9 @@ namespace neolib::ecs
     public:
         const i_entity_archetype& archetype(entity_archetype_id aArchetypeId) const final;
         i_entity_archetype& archetype(entity_archetype_id aArchetypeId) final;
+        bool archetype_storage_instantiated(entity_archetype_id aArchetypeId) const final;
+        const i_archetype_storage& archetype_storage(entity_archetype_id aArchetypeId) const final;
+        i_archetype_storage& archetype_storage(entity_archetype_id aArchetypeId) final;
         bool component_instantiated(component_id aComponentId) const final;
         const i_component& component(component_id aComponentId) const final;
         i_component& component(component_id aComponentId) final;
@@ -110,6 +123,7 @@ namespace neolib::ecs
         bool archetype_registered(const i_entity_archetype& aArchetype) const final;
         void register_archetype(const i_entity_archetype& aArchetype) final;
         void register_archetype(std::shared_ptr<const i_entity_archetype> aArchetype) final;
+        void register_archetype_storage(std::unique_ptr<i_archetype_storage> aStorage) final;
         bool component_registered(component_id aComponentId) const final;
         void register_component(component_id aComponentId, component_factory aFactory) final;
         bool shared_component_registered(component_id aComponentId) const final;
@@ -126,9 +140,13 @@ namespace neolib::ecs
         void free_handle_id(handle_id aId);
     public:
         using i_ecs::create_entity;
+        using i_ecs::async_create_entity;
     public:
         using i_ecs::populate;
         using i_ecs::populate_shared;
+        using i_ecs::archetype_storage;
+        using i_ecs::apply_chunks;
+        using i_ecs::view;
         using i_ecs::component_instantiated;
         using i_ecs::component;
         using i_ecs::shared_component_instantiated;
@@ -145,8 +163,12 @@ namespace neolib::ecs
     private:
         mutable neolib::recursive_spinlock iMutex;
         mutable std::optional<neolib::thread_pool> iThreadPool;
+        neolib::thread_placement iSystemThreadPlacement;
+        std::size_t iNextSystemThreadIndex;
+        std::set<std::size_t> iFreeSystemThreadIndices;
         ecs_flags iFlags;
         archetype_registry_t iArchetypeRegistry;
+        archetype_storages_t iArchetypeStorages;
         component_factories_t iComponentFactories;
         mutable components_t iComponents;
         mutable std::vector<proxy_mutex<i_lockable>> iComponentMutexes;
@@ -161,6 +183,7 @@ namespace neolib::ecs
         handle_id iNextHandleId;
         std::vector<handle_id> iFreedHandleIds;
         handles_t iHandles;
+        mutable system_scheduler iSystemScheduler;
         neolib::callback_timer iSystemTimer;
         std::atomic<bool> iSystemsPaused;
     };
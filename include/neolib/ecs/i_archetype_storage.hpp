@@ -0,0 +1,88 @@
+// i_archetype_storage.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <neolib/core/i_mutex.hpp>
+#include <neolib/ecs/ecs_ids.hpp>
+#include <neolib/ecs/i_component_data.hpp>
+
+namespace neolib::ecs
+{
+    class i_ecs;
+
+    // Storage for the entities of a single archetype: entities with the same component set are
+    // kept together in fixed-size chunks each holding one column per component (structure of arrays).
+    class i_archetype_storage
+    {
+    public:
+        struct entity_not_found : std::logic_error { entity_not_found() : std::logic_error("neolib::ecs::i_archetype_storage::entity_not_found") {} };
+        struct component_not_found : std::logic_error { component_not_found() : std::logic_error("neolib::ecs::i_archetype_storage::component_not_found") {} };
+        struct invalid_data : std::logic_error { invalid_data() : std::logic_error("neolib::ecs::i_archetype_storage::invalid_data") {} };
+    public:
+        virtual ~i_archetype_storage() = default;
+    public:
+        virtual i_ecs& ecs() const = 0;
+        virtual const entity_archetype_id& id() const = 0;
+    public:
+        virtual neolib::i_lockable& mutex() const = 0;
+    public:
+        virtual bool has_component(component_id aComponentId) const = 0;
+        virtual std::size_t entity_count() const = 0;
+        virtual bool has_entity_no_lock(entity_id aEntity) const = 0;
+        virtual bool has_entity(entity_id aEntity) const = 0;
+        virtual void destroy_entity(entity_id aEntity) = 0;
+    public:
+        // adds a row for the entity with value-initialized components if it doesn't already have one
+        virtual void add_entity(entity_id aEntity) = 0;
+        virtual void populate_component(entity_id aEntity, component_id aComponentId, const void* aComponentData, std::size_t aComponentDataSize) = 0;
+        template <typename ComponentData>
+        void populate_component(entity_id aEntity, ComponentData&& aComponentData)
+        {
+            populate_component(aEntity, ecs_data_type_t<ComponentData>::meta::id(), &aComponentData, sizeof(ecs_data_type_t<ComponentData>));
+        }
+    public:
+        virtual std::size_t chunk_capacity() const = 0;
+        virtual std::size_t chunk_count() const = 0;
+        virtual std::size_t chunk_size(std::size_t aChunk) const = 0;
+        virtual const entity_id* chunk_entities(std::size_t aChunk) const = 0;
+        virtual const void* chunk_column(std::size_t aChunk, component_id aComponentId) const = 0;
+        virtual void* chunk_column(std::size_t aChunk, component_id aComponentId) = 0;
+    };
+
+    template <typename... ComponentData>
+    class archetype_storage;
+}
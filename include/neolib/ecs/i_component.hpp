@@ -63,12 +63,27 @@ namespace neolib::ecs
         virtual const neolib::i_string& field_name(uint32_t aFieldIndex) const = 0;
     };
 
+    class i_component;
+
+    // Notified (with the component's mutex held) when an entity gains or loses a record in a component
+    class i_component_observer
+    {
+    public:
+        virtual ~i_component_observer() = default;
+    public:
+        virtual void entity_record_added(const i_component& aComponent, entity_id aEntity) = 0;
+        virtual void entity_record_removed(const i_component& aComponent, entity_id aEntity) = 0;
+    };
+
     class i_component : public i_component_base
     {
     public:
         virtual bool has_entity_record_no_lock(entity_id aEntity) const = 0;
         virtual bool has_entity_record(entity_id aEntity) const = 0;
         virtual void destroy_entity_record(entity_id aEntity) = 0;
+    public:
+        virtual void add_observer(i_component_observer& aObserver) = 0;
+        virtual void remove_observer(i_component_observer& aObserver) = 0;
     public:
         virtual const void* populate(entity_id aEntity, const void* aComponentData, std::size_t aComponentDataSize) = 0;
         template <typename ComponentData>
@@ -36,14 +36,18 @@
 #pragma once
 
 #include <neolib/neolib.hpp>
+#include <vector>
 #include <unordered_map>
+#include <span>
 #include <neolib/core/i_mutex.hpp>
+#include <neolib/task/thread.hpp>
 #include <neolib/task/thread_pool.hpp>
 #include <neolib/task/event.hpp>
 #include <neolib/app/i_object.hpp>
 #include <neolib/ecs/ecs_ids.hpp>
 #include <neolib/ecs/i_entity_archetype.hpp>
 #include <neolib/ecs/i_component.hpp>
+#include <neolib/ecs/i_archetype_storage.hpp>
 #include <neolib/ecs/i_system.hpp>
 
 namespace neolib::ecs
@@ -57,6 +61,7 @@ namespace neolib::ecs
         Turbo               = 0x0002,
         CreatePaused        = 0x0004,
         NoThreads           = 0x0008,
+        ParallelSystems     = 0x0010,   // systems are run each frame by the system scheduler on the thread pool rather than on their own threads
 
         Default             = PopulateEntityInfo | Turbo
     };
@@ -81,6 +86,11 @@ namespace neolib::ecs
         return aLhs = static_cast<ecs_flags>(static_cast<uint32_t>(aLhs) & static_cast<uint32_t>(aRhs));
     }
 
+    template <typename... Data>
+    class view;
+    template <typename... Data>
+    class view_cache;
+
     class i_ecs : public i_object
     {
     public:
@@ -103,6 +113,7 @@ namespace neolib::ecs
         typedef std::function<std::unique_ptr<i_system>()> system_factory;
     protected:
         typedef std::unordered_map<entity_archetype_id, std::shared_ptr<const i_entity_archetype>, quick_uuid_hash> archetype_registry_t;
+        typedef std::unordered_map<entity_archetype_id, std::unique_ptr<i_archetype_storage>, quick_uuid_hash> archetype_storages_t;
         typedef std::unordered_map<component_id, component_factory, quick_uuid_hash> component_factories_t;
         typedef std::unordered_map<component_id, std::unique_ptr<i_component>, quick_uuid_hash> components_t;
         typedef std::unordered_map<component_id, shared_component_factory, quick_uuid_hash> shared_component_factories_t;
@@ -114,9 +125,13 @@ namespace neolib::ecs
     public:
         virtual neolib::i_lockable& mutex() const = 0;
         virtual neolib::thread_pool& thread_pool() const = 0; // todo: polymorphic threadpool
+        virtual neolib::thread_placement system_thread_placement() const = 0;
+        virtual void set_system_thread_placement(neolib::thread_placement const& aPlacement) = 0;
+        virtual std::size_t place_system_thread(neolib::thread& aSystemThread) = 0;
+        virtual void release_system_thread(std::size_t aPlacementIndex) = 0;
     public:
         virtual ecs_flags flags() const = 0;
-        virtual entity_id create_entity(const entity_archetype_id& aArchetypeId) = 0;
+        virtual entity_id create_entity(const entity_archetype_id& aArchetypeId, bool aNotify = true) = 0;
         virtual void async_create_entity(const std::function<void()>& aCreator) = 0; // todo: polymorphic functor
         virtual void commit_async_entity_creation() = 0;
         virtual void destroy_entity(entity_id aEntityId, bool aNotify = true) = 0;
@@ -130,6 +145,8 @@ namespace neolib::ecs
     public:
         virtual const archetype_registry_t& archetypes() const = 0;
         virtual archetype_registry_t& archetypes() = 0;
+        virtual const archetype_storages_t& archetype_storages() const = 0;
+        virtual archetype_storages_t& archetype_storages() = 0;
         virtual const component_factories_t& component_factories() const = 0;
         virtual component_factories_t& component_factories() = 0;
         virtual const components_t& components() const = 0;
@@ -145,6 +162,9 @@ namespace neolib::ecs
     public:
         virtual const i_entity_archetype& archetype(entity_archetype_id aArchetypeId) const = 0;
         virtual i_entity_archetype& archetype(entity_archetype_id aArchetypeId) = 0;
+        virtual bool archetype_storage_instantiated(entity_archetype_id aArchetypeId) const = 0;
+        virtual const i_archetype_storage& archetype_storage(entity_archetype_id aArchetypeId) const = 0;
+        virtual i_archetype_storage& archetype_storage(entity_archetype_id aArchetypeId) = 0;
         virtual bool component_instantiated(component_id aComponentId) const = 0;
         virtual const i_component& component(component_id aComponentId) const = 0;
         virtual i_component& component(component_id aComponentId) = 0;
@@ -161,6 +181,7 @@ namespace neolib::ecs
         virtual bool archetype_registered(const i_entity_archetype& aArchetype) const = 0;
         virtual void register_archetype(const i_entity_archetype& aArchetype) = 0;
         virtual void register_archetype(std::shared_ptr<const i_entity_archetype> aArchetype) = 0;
+        virtual void register_archetype_storage(std::unique_ptr<i_archetype_storage> aStorage) = 0;
         virtual bool component_registered(component_id aComponentId) const = 0;
         virtual void register_component(component_id aComponentId, component_factory aFactory) = 0;
         virtual bool shared_component_registered(component_id aComponentId) const = 0;
@@ -239,6 +260,48 @@ namespace neolib::ecs
                 register_shared_component<ecs_data_type_t<ComponentData>>();
             return const_cast<neolib::ecs::shared_component<ecs_data_type_t<ComponentData>>&>(to_const(*this).shared_component<ecs_data_type_t<ComponentData>>());
         }
+        template <typename Archetype>
+        typename Archetype::storage_type& archetype_storage(const Archetype& aArchetype)
+        {
+            if (!archetype_storage_instantiated(aArchetype.id()))
+                register_archetype_storage(std::make_unique<typename Archetype::storage_type>(*this, aArchetype.id()));
+            return static_cast<typename Archetype::storage_type&>(archetype_storage(aArchetype.id()));
+        }
+        // aCallable(std::span<const entity_id>, std::span<ComponentData>...) is called for each chunk of each
+        // archetype storage holding all of ComponentData
+        template <typename... ComponentData, typename Callable>
+        void apply_chunks(const Callable& aCallable)
+        {
+            // storages are registered under the ECS mutex but entity creation locks a storage before the ECS
+            // mutex so the matching storages are collected first and each one is locked without the ECS mutex
+            std::vector<i_archetype_storage*> matching;
+            {
+                std::scoped_lock<neolib::i_lockable> lock{ mutex() };
+                for (auto& storage : archetype_storages())
+                    if ((storage.second->has_component(ecs_data_type_t<ComponentData>::meta::id()) && ...))
+                        matching.push_back(&*storage.second);
+            }
+            for (auto storage : matching)
+            {
+                std::scoped_lock<neolib::i_lockable> lock{ storage->mutex() };
+                for (std::size_t chunk = 0u; chunk < storage->chunk_count(); ++chunk)
+                {
+                    auto const size = storage->chunk_size(chunk);
+                    aCallable(std::span<const entity_id>{ storage->chunk_entities(chunk), size },
+                        std::span<ComponentData>{ static_cast<ComponentData*>(storage->chunk_column(chunk, ecs_data_type_t<ComponentData>::meta::id())), size }...);
+                }
+            }
+        }
+        template <typename... Data>
+        neolib::ecs::view<Data...> view()
+        {
+            return neolib::ecs::view<Data...>{ *this };
+        }
+        template <typename... Data>
+        neolib::ecs::view<Data...> view(neolib::ecs::view_cache<Data...>& aCache)
+        {
+            return neolib::ecs::view<Data...>{ aCache };
+        }
         template <typename System>
         bool system_instantiated() const
         {
@@ -485,6 +548,17 @@ namespace neolib::ecs
     template <typename... ComponentData>
     inline entity_id i_ecs::create_entity(const entity_archetype_id& aArchetypeId, ComponentData&&... aComponentData)
     {
+        if (archetype_storage_instantiated(aArchetypeId))
+        {
+            // the entity is complete in its archetype's storage before anyone is told it exists
+            auto& storage = archetype_storage(aArchetypeId);
+            std::scoped_lock<neolib::i_lockable> lock{ storage.mutex() };
+            auto newEntity = create_entity(aArchetypeId, false);
+            (storage.populate_component(newEntity, std::forward<ComponentData>(aComponentData)), ...);
+            archetype(aArchetypeId).populate_default_components(*this, newEntity);
+            entity_created().trigger(newEntity);
+            return newEntity;
+        }
         scoped_component_lock<std::decay_t<ComponentData>...> lock{ *this };
         auto newEntity = create_entity(aArchetypeId);
         populate(newEntity, std::forward<ComponentData>(aComponentData)...);
@@ -497,6 +571,8 @@ namespace neolib::ecs
     {
         if (!archetype_registered(aArchetype))
             register_archetype(aArchetype);
+        if constexpr (requires { typename Archetype::storage_type; })
+            archetype_storage(aArchetype); // instantiate the storage so creation is routed to it
         return create_entity(aArchetype.id(), std::forward<ComponentData>(aComponentData)...);
     }
 
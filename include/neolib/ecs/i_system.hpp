@@ -62,6 +62,9 @@ namespace neolib::ecs
     public:
         virtual const neolib::i_set<component_id>& components() const = 0;
         virtual neolib::i_set<component_id>& components() = 0;
+        // the subset of components() the system modifies; the remainder are only read. With
+        // ecs_flags::ParallelSystems these declarations are all that keeps systems from racing.
+        virtual const neolib::i_set<component_id>& written_components() const = 0;
     public:
         virtual const i_component& component(component_id aComponentId) const = 0;
         virtual const i_component& component(component_id aComponentId) = 0;
@@ -0,0 +1,171 @@
+// sparse_index.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <array>
+#include <memory>
+#include <vector>
+#include <neolib/ecs/ecs_ids.hpp>
+
+namespace neolib::ecs
+{
+    // Maps entity ids to values (typically an index into dense component storage) with O(1) lookup.
+    // Values live in fixed-size pages allocated on first use and freed once they hold no valid entry,
+    // so memory is proportional to the entities actually present rather than to the highest entity id.
+    template <typename Value, std::size_t PageSize = 4096u>
+    class paged_sparse_index
+    {
+        typedef paged_sparse_index<Value, PageSize> self_type;
+    public:
+        typedef Value value_type;
+        static constexpr std::size_t page_size = PageSize;
+    private:
+        struct page
+        {
+            std::array<value_type, page_size> values;
+            std::size_t used = 0u;
+        };
+        typedef std::vector<std::unique_ptr<page>> pages_t;
+    public:
+        paged_sparse_index(value_type const& aInvalid) :
+            iInvalid{ aInvalid }, iPageCount{ 0u }
+        {
+        }
+        paged_sparse_index(self_type const& aOther) :
+            iInvalid{ aOther.iInvalid }, iPageCount{ 0u }
+        {
+            *this = aOther;
+        }
+        paged_sparse_index(self_type&& aOther) noexcept :
+            iInvalid{ aOther.iInvalid }, iPages{ std::move(aOther.iPages) }, iPageCount{ aOther.iPageCount }
+        {
+            aOther.iPageCount = 0u;
+        }
+    public:
+        self_type& operator=(self_type const& aOther)
+        {
+            if (&aOther == this)
+                return *this;
+            pages_t pages(aOther.iPages.size());
+            for (std::size_t p = 0u; p < pages.size(); ++p)
+                if (aOther.iPages[p])
+                    pages[p] = std::make_unique<page>(*aOther.iPages[p]);
+            iInvalid = aOther.iInvalid;
+            iPages = std::move(pages);
+            iPageCount = aOther.iPageCount;
+            return *this;
+        }
+        self_type& operator=(self_type&& aOther) noexcept
+        {
+            iInvalid = aOther.iInvalid;
+            iPages = std::move(aOther.iPages);
+            iPageCount = aOther.iPageCount;
+            aOther.iPageCount = 0u;
+            return *this;
+        }
+    public:
+        value_type const& invalid() const
+        {
+            return iInvalid;
+        }
+        bool contains(entity_id aEntity) const
+        {
+            return (*this)[aEntity] != iInvalid;
+        }
+        // returns invalid() if aEntity has no value
+        value_type const& operator[](entity_id aEntity) const
+        {
+            auto const p = static_cast<std::size_t>(aEntity / page_size);
+            if (p < iPages.size() && iPages[p])
+                return iPages[p]->values[aEntity % page_size];
+            return iInvalid;
+        }
+        void set(entity_id aEntity, value_type const& aValue)
+        {
+            if (aValue == iInvalid)
+            {
+                reset(aEntity);
+                return;
+            }
+            auto const p = static_cast<std::size_t>(aEntity / page_size);
+            if (p >= iPages.size())
+                iPages.resize(p + 1u);
+            if (!iPages[p])
+            {
+                iPages[p] = std::make_unique<page>();
+                iPages[p]->values.fill(iInvalid);
+                ++iPageCount;
+            }
+            auto& existing = iPages[p]->values[aEntity % page_size];
+            if (existing == iInvalid)
+                ++iPages[p]->used;
+            existing = aValue;
+        }
+        void reset(entity_id aEntity)
+        {
+            auto const p = static_cast<std::size_t>(aEntity / page_size);
+            if (p >= iPages.size() || !iPages[p])
+                return;
+            auto& existing = iPages[p]->values[aEntity % page_size];
+            if (existing == iInvalid)
+                return;
+            existing = iInvalid;
+            if (--iPages[p]->used == 0u)
+            {
+                iPages[p] = nullptr;
+                --iPageCount;
+                while (!iPages.empty() && !iPages.back())
+                    iPages.pop_back();
+            }
+        }
+        void clear()
+        {
+            iPages.clear();
+            iPageCount = 0u;
+        }
+    public:
+        // number of pages currently allocated
+        std::size_t page_count() const
+        {
+            return iPageCount;
+        }
+    private:
+        value_type iInvalid;
+        pages_t iPages;
+        std::size_t iPageCount;
+    };
+}
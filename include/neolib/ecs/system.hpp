@@ -62,6 +62,7 @@ namespace neolib::ecs
         bool do_work(neolib::yield_type aYieldType = neolib::yield_type::NoYield) final;
     private:
         i_system& iOwner;
+        std::size_t iPlacementIndex;
     };
 
     template <typename... ComponentData>
@@ -79,26 +80,28 @@ namespace neolib::ecs
     public:
         struct no_thread : std::logic_error { no_thread() : std::logic_error{ "neolib::ecs::system::no_thread" } {} };
     public:
+        // a const qualified ComponentData is only read by the system
         system(i_ecs& aEcs) :
-            iEcs{ aEcs }, iComponents{ ComponentData::meta::id()... }, iPaused{ 0u }
+            iEcs{ aEcs }, iComponents{ ecs_data_type_t<ComponentData>::meta::id()... }, iWrittenComponents{ written_components_of() }, iPaused{ 0u }
         {
-            (ecs().template component<ComponentData>(), ...);
+            (ecs().template component<ecs_data_type_t<ComponentData>>(), ...);
         }
         system(const system& aOther) :
-            iEcs{ aOther.iEcs }, iComponents{ aOther.iComponents }, iPaused{ 0u }
+            iEcs{ aOther.iEcs }, iComponents{ aOther.iComponents }, iWrittenComponents{ aOther.iWrittenComponents }, iPaused{ 0u }
         {
-            (ecs().template component<ComponentData>(), ...);
+            (ecs().template component<ecs_data_type_t<ComponentData>>(), ...);
         }
         system(system&& aOther) :
-            iEcs{ aOther.iEcs }, iComponents{ std::move(aOther.iComponents) }, iPaused{ 0u }
+            iEcs{ aOther.iEcs }, iComponents{ std::move(aOther.iComponents) }, iWrittenComponents{ std::move(aOther.iWrittenComponents) }, iPaused{ 0u }
         {
-            (ecs().template component<ComponentData>(), ...);
+            (ecs().template component<ecs_data_type_t<ComponentData>>(), ...);
         }
+        // components given by id are all assumed to be written
         template <typename ComponentIdIter>
         system(i_ecs& aEcs, ComponentIdIter aFirstComponent, ComponentIdIter aLastComponent) :
-            iEcs{ aEcs }, iComponents{ aFirstComponent, aLastComponent }, iPaused{ 0u }
+            iEcs{ aEcs }, iComponents{ aFirstComponent, aLastComponent }, iWrittenComponents{ aFirstComponent, aLastComponent }, iPaused{ 0u }
         {
-            (ecs().template component<ComponentData>(), ...);
+            (ecs().template component<ecs_data_type_t<ComponentData>>(), ...);
             if (ecs().all_systems_paused())
                 pause();
         }
@@ -119,6 +122,10 @@ namespace neolib::ecs
         {
             return iComponents;
         }
+        const i_set<component_id>& written_components() const final
+        {
+            return iWrittenComponents;
+        }
     public:
         const i_component& component(component_id aComponentId) const final
         {
@@ -223,6 +230,13 @@ namespace neolib::ecs
                 return std::chrono::microseconds{ 0 };
             return std::accumulate(iPerformanceMetrics[aMetricsIndex].updateTimes.begin(), iPerformanceMetrics[aMetricsIndex].updateTimes.end(), std::chrono::microseconds{}) / iPerformanceMetrics[aMetricsIndex].updateTimes.size();
         }
+    private:
+        static component_list written_components_of()
+        {
+            component_list result;
+            ((std::is_const_v<ComponentData> ? void() : void(result.insert(ecs_data_type_t<ComponentData>::meta::id()))), ...);
+            return result;
+        }
     protected:
         bool have_thread() const
         {
@@ -275,6 +289,7 @@ namespace neolib::ecs
     private:
         i_ecs& iEcs;
         component_list iComponents;
+        component_list iWrittenComponents;
         std::atomic<uint32_t> iPaused = 0u;
         std::mutex iMutex;
         std::condition_variable iCondVar;
@@ -0,0 +1,76 @@
+// system_scheduler.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <neolib/task/task_graph.hpp>
+#include <neolib/ecs/i_system.hpp>
+
+namespace neolib::ecs
+{
+    class i_ecs;
+
+    // Runs one frame of systems on the ecs thread pool. Systems that conflict (share a component that
+    // at least one of them writes) are ordered by instantiation; all others may run concurrently. The
+    // dependency graph is rebuilt only when a system is added.
+    // Ordering is derived solely from each system's components() and written_components(): a system
+    // that touches a component it hasn't declared (or writes one it only declared as read) can race
+    // with other systems, as the scheduler doesn't hold component locks around apply().
+    class NEOLIB_EXPORT system_scheduler
+    {
+    public:
+        system_scheduler(i_ecs& aEcs);
+        ~system_scheduler();
+    public:
+        std::size_t system_count() const;
+        void add_system(i_system& aSystem);
+        // applies each system that can_apply() and waits for them all to finish
+        void run();
+    public:
+        static bool conflicts(i_system const& aFirst, i_system const& aSecond);
+    private:
+        void build();
+    private:
+        i_ecs& iEcs;
+        mutable std::mutex iMutex;
+        std::vector<i_system*> iSystems;
+        std::shared_ptr<neolib::task_graph> iGraph;
+        bool iDirty;
+    };
+}
@@ -0,0 +1,273 @@
+// view.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <iterator>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <neolib/core/mutex.hpp>
+#include <neolib/ecs/ecs_ids.hpp>
+#include <neolib/ecs/i_ecs.hpp>
+#include <neolib/ecs/component.hpp>
+#include <neolib/ecs/sparse_index.hpp>
+
+namespace neolib::ecs
+{
+    // Optional, incrementally maintained list of the entities having all of the components Data. The
+    // cache observes each component and queues the entities whose records were added or removed; the
+    // queue is applied by the next view using the cache (while that view holds the component locks).
+    // A view_cache must not outlive its ecs.
+    template <typename... Data>
+    class view_cache : public i_component_observer
+    {
+        template <typename...>
+        friend class view;
+        typedef view_cache<Data...> self_type;
+    private:
+        static constexpr std::size_t invalid = ~std::size_t{};
+    public:
+        view_cache(i_ecs& aEcs) :
+            iEcs{ aEcs }, iPositions{ invalid }, iBuilt{ false }
+        {
+            (ecs().template component<ecs_data_type_t<Data>>().add_observer(*this), ...);
+        }
+        ~view_cache()
+        {
+            (ecs().template component<ecs_data_type_t<Data>>().remove_observer(*this), ...);
+        }
+        view_cache(const self_type&) = delete;
+        self_type& operator=(const self_type&) = delete;
+    public:
+        i_ecs& ecs() const
+        {
+            return iEcs;
+        }
+    public:
+        void entity_record_added(const i_component&, entity_id aEntity) final
+        {
+            changed(aEntity);
+        }
+        void entity_record_removed(const i_component&, entity_id aEntity) final
+        {
+            changed(aEntity);
+        }
+    private:
+        void changed(entity_id aEntity)
+        {
+            std::scoped_lock<neolib::spinlock> lock{ iPendingMutex };
+            if (iBuilt)
+                iPending.push_back(aEntity);
+        }
+        bool matches(entity_id aEntity) const
+        {
+            return (ecs().template component<ecs_data_type_t<Data>>().has_entity_record_no_lock(aEntity) && ...);
+        }
+        // the caller must hold the locks of all of the components Data
+        const std::vector<entity_id>& entities(const std::vector<entity_id>& aSmallest)
+        {
+            std::scoped_lock<neolib::spinlock> lock{ iPendingMutex };
+            if (!iBuilt)
+            {
+                for (auto entity : aSmallest)
+                    if (matches(entity))
+                        add(entity);
+                iBuilt = true;
+            }
+            for (auto entity : iPending)
+            {
+                bool const match = matches(entity);
+                bool const present = iPositions.contains(entity);
+                if (match && !present)
+                    add(entity);
+                else if (!match && present)
+                    remove(entity);
+            }
+            iPending.clear();
+            return iEntities;
+        }
+        void add(entity_id aEntity)
+        {
+            iPositions.set(aEntity, iEntities.size());
+            iEntities.push_back(aEntity);
+        }
+        void remove(entity_id aEntity)
+        {
+            auto const position = iPositions[aEntity];
+            auto const tailEntity = iEntities.back();
+            iEntities[position] = tailEntity;
+            iEntities.pop_back();
+            iPositions.set(tailEntity, position);
+            iPositions.reset(aEntity);
+        }
+    private:
+        i_ecs& iEcs;
+        std::vector<entity_id> iEntities;
+        paged_sparse_index<std::size_t> iPositions;
+        neolib::spinlock iPendingMutex;
+        std::vector<entity_id> iPending;
+        bool iBuilt;
+    };
+
+    // Iterates the entities having all of the components Data yielding (entity, records...); a const
+    // qualified component type yields a const record. The locks of all of the components are acquired
+    // once, for the lifetime of the view. Without a cache the component with the fewest records drives
+    // the iteration and the others are probed; with a view_cache only matching entities are visited.
+    // Populating or destroying records of the viewed components while iterating invalidates iterators.
+    template <typename... Data>
+    class view
+    {
+        typedef view<Data...> self_type;
+    public:
+        static_assert(sizeof...(Data) > 0, "neolib::ecs::view: no components");
+    private:
+        template <typename T>
+        using component_t = neolib::ecs::component<ecs_data_type_t<T>>;
+        template <typename T>
+        using record_t = std::conditional_t<std::is_const_v<std::remove_reference_t<T>>, typename component_t<T>::value_type const&, typename component_t<T>::value_type&>;
+    public:
+        typedef std::tuple<entity_id, record_t<Data>...> value_type;
+        typedef view_cache<Data...> cache_type;
+    public:
+        class iterator
+        {
+            friend class view;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = typename view::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+        public:
+            iterator() :
+                iOwner{ nullptr }, iIndex{ 0u }
+            {
+            }
+        private:
+            iterator(const view& aOwner, std::size_t aIndex) :
+                iOwner{ &aOwner }, iIndex{ aIndex }
+            {
+                skip();
+            }
+        public:
+            reference operator*() const
+            {
+                return iOwner->record((*iOwner->iEntities)[iIndex]);
+            }
+            iterator& operator++()
+            {
+                ++iIndex;
+                skip();
+                return *this;
+            }
+            iterator operator++(int)
+            {
+                auto old = *this;
+                ++(*this);
+                return old;
+            }
+            bool operator==(const iterator& aOther) const
+            {
+                return iIndex == aOther.iIndex;
+            }
+        private:
+            void skip()
+            {
+                while (iIndex < iOwner->iEntities->size() && !iOwner->matches((*iOwner->iEntities)[iIndex]))
+                    ++iIndex;
+            }
+        private:
+            const view* iOwner;
+            std::size_t iIndex;
+        };
+        typedef iterator const_iterator;
+    public:
+        view(i_ecs& aEcs) :
+            iLock{ aEcs }, iComponents{ &aEcs.template component<ecs_data_type_t<Data>>()... }, iEntities{ &smallest() }, iFiltered{ sizeof...(Data) > 1 }
+        {
+        }
+        view(cache_type& aCache) :
+            iLock{ aCache.ecs() }, iComponents{ &aCache.ecs().template component<ecs_data_type_t<Data>>()... }, iEntities{ &aCache.entities(smallest()) }, iFiltered{ false }
+        {
+        }
+        view(const self_type&) = delete;
+        self_type& operator=(const self_type&) = delete;
+    public:
+        iterator begin() const
+        {
+            return iterator{ *this, 0u };
+        }
+        iterator end() const
+        {
+            return iterator{ *this, iEntities->size() };
+        }
+        // aCallable(entity_id, records...) is called for each matching entity
+        template <typename Callable>
+        void each(const Callable& aCallable) const
+        {
+            for (auto entity : *iEntities)
+                if (matches(entity))
+                    aCallable(entity, component<Data>().entity_record_no_lock(entity)...);
+        }
+    private:
+        template <typename T>
+        component_t<T>& component() const
+        {
+            return *std::get<index_of_v<T, Data...>>(iComponents);
+        }
+        const std::vector<entity_id>& smallest() const
+        {
+            const std::vector<entity_id>* result = nullptr;
+            ((result == nullptr || component<Data>().entities().size() < result->size() ? void(result = &component<Data>().entities()) : void()), ...);
+            return *result;
+        }
+        bool matches(entity_id aEntity) const
+        {
+            return !iFiltered || (component<Data>().has_entity_record_no_lock(aEntity) && ...);
+        }
+        value_type record(entity_id aEntity) const
+        {
+            return value_type{ aEntity, component<Data>().entity_record_no_lock(aEntity)... };
+        }
+    private:
+        scoped_component_lock<ecs_data_type_t<Data>...> iLock;
+        std::tuple<component_t<Data>*...> iComponents;
+        const std::vector<entity_id>* iEntities;
+        bool iFiltered;
+    };
+}
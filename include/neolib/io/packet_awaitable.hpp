@@ -0,0 +1,144 @@
+// packet_awaitable.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <algorithm>
+#include <boost/system/system_error.hpp>
+#include <boost/asio/error.hpp>
+#include <neolib/task/coroutine.hpp>
+#include <neolib/io/packet_stream.hpp>
+
+namespace neolib
+{
+    namespace detail
+    {
+        template <typename Stream, typename Result>
+        inline void subscribe_failures(Stream& aStream, std::weak_ptr<detail::awaited_result<Result>> const& aResult)
+        {
+            auto const fail = [aResult](boost::system::error_code const& aError)
+            {
+                if (auto r = aResult.lock())
+                    r->fail(std::make_exception_ptr(boost::system::system_error{ aError }));
+            };
+            auto const result = aResult.lock();
+            result->subscribe(make_ref<slot<const boost::system::error_code&>>(aStream.transfer_failure(), fail, true));
+            result->subscribe(make_ref<slot<const boost::system::error_code&>>(aStream.connection_failure(), fail, true));
+            result->subscribe(make_ref<slot<>>(aStream.connection_closed(), [fail]()
+            {
+                fail(boost::asio::error::make_error_code(boost::asio::error::connection_aborted));
+            }, true));
+        }
+    }
+
+    // Awaitable packet I/O on a packet_stream (and so on its underlying packet_connection). The awaiting
+    // coroutine is resumed on the stream's I/O task thread; a transfer failure or the connection closing
+    // is reported as a boost::system::system_error. The stream is not thread-safe so these must be
+    // awaited from its I/O task thread (e.g. after co_await resume_on(ioTask)).
+    template <typename PacketType, typename Protocol, size_t ReceiveBufferSize>
+    class packet_receive_awaitable : public detail::callback_awaiter<PacketType>
+    {
+        typedef detail::callback_awaiter<PacketType> base_type;
+    public:
+        typedef packet_stream<PacketType, Protocol, ReceiveBufferSize> stream_type;
+    public:
+        explicit packet_receive_awaitable(stream_type& aStream) :
+            iStream{ aStream }
+        {
+        }
+    public:
+        bool await_suspend(std::coroutine_handle<> aHandle)
+        {
+            auto& result = base_type::iResult;
+            std::weak_ptr<typename base_type::result_type> weakResult = result;
+            result->subscribe(make_ref<slot<const PacketType&>>(iStream.packet_arrived(), [weakResult](const PacketType& aPacket)
+            {
+                if (auto r = weakResult.lock())
+                    r->complete(aPacket);
+            }, true));
+            detail::subscribe_failures(iStream, weakResult);
+            return result->suspend(aHandle);
+        }
+    private:
+        stream_type& iStream;
+    };
+
+    template <typename PacketType, typename Protocol, size_t ReceiveBufferSize>
+    class packet_send_awaitable : public detail::callback_awaiter<void>
+    {
+        typedef detail::callback_awaiter<void> base_type;
+    public:
+        typedef packet_stream<PacketType, Protocol, ReceiveBufferSize> stream_type;
+    public:
+        packet_send_awaitable(stream_type& aStream, const PacketType& aPacket, bool aHighPriority) :
+            iStream{ aStream }, iPacket{ aPacket }, iHighPriority{ aHighPriority }
+        {
+        }
+    public:
+        bool await_suspend(std::coroutine_handle<> aHandle)
+        {
+            auto& result = base_type::iResult;
+            std::weak_ptr<typename base_type::result_type> weakResult = result;
+            // the stream sends a copy of the packet so a sent packet is matched on its contents
+            result->subscribe(make_ref<slot<const PacketType&>>(iStream.packet_sent(), [weakResult, packet = iPacket](const PacketType& aPacket)
+            {
+                if (aPacket.length() != packet.length() || !std::equal(aPacket.begin(), aPacket.end(), packet.begin()))
+                    return;
+                if (auto r = weakResult.lock())
+                    r->complete();
+            }, true));
+            detail::subscribe_failures(iStream, weakResult);
+            iStream.send_packet(iPacket, iHighPriority);
+            return result->suspend(aHandle);
+        }
+    private:
+        stream_type& iStream;
+        PacketType iPacket;
+        bool iHighPriority;
+    };
+
+    template <typename PacketType, typename Protocol, size_t ReceiveBufferSize>
+    inline packet_receive_awaitable<PacketType, Protocol, ReceiveBufferSize> async_receive(packet_stream<PacketType, Protocol, ReceiveBufferSize>& aStream)
+    {
+        return packet_receive_awaitable<PacketType, Protocol, ReceiveBufferSize>{ aStream };
+    }
+
+    template <typename PacketType, typename Protocol, size_t ReceiveBufferSize>
+    inline packet_send_awaitable<PacketType, Protocol, ReceiveBufferSize> async_send(packet_stream<PacketType, Protocol, ReceiveBufferSize>& aStream, const PacketType& aPacket, bool aHighPriority = false)
+    {
+        return packet_send_awaitable<PacketType, Protocol, ReceiveBufferSize>{ aStream, aPacket, aHighPriority };
+    }
+}
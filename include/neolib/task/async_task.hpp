@@ -37,6 +37,9 @@
 
 #include <neolib/neolib.hpp>
 #include <atomic>
+#include <array>
+#include <condition_variable>
+#include <mutex>
 #include <neolib/core/lifetime.hpp>
 #include <neolib/task/i_thread.hpp>
 #include <neolib/task/task.hpp>
@@ -47,26 +50,62 @@
 namespace neolib
 {
     class async_task;
+    class timer_object;
 
+    // Armed timer objects are kept in a hierarchical timing wheel (Varghese & Lauck) of
+    // kWheelLevels levels of kWheelSlots slots with a resolution of one millisecond; arming
+    // and cancelling a timer is O(1) and polling only visits expired timers. A timer with
+    // slack is placed on the most coarsely aligned tick within its window so that timers
+    // with overlapping windows share a slot and expire together.
     class NEOLIB_EXPORT timer_service : public i_timer_service
     {
         // types
     public:
+        // constants
+    public:
+        static constexpr std::uint32_t kWheelLevels = 4u;
+        static constexpr std::uint32_t kWheelSlotBits = 8u;
+        static constexpr std::uint32_t kWheelSlots = 1u << kWheelSlotBits;
+    private:
+        static constexpr std::uint32_t kExpiredList = 0u;
+        static constexpr std::uint32_t kOverflowList = 1u;
+        static constexpr std::uint32_t kFirstWheelList = 2u;
+        static constexpr std::uint32_t kWheelLists = kFirstWheelList + kWheelLevels * kWheelSlots;
         // construction
     public:
         timer_service(async_task& aTask, bool aMultiThreaded = false);
+        ~timer_service();
         // operations
     public:
         bool poll(bool aProcessEvents = true, std::size_t aMaximumPollCount = kDefaultPollCount) override;
         void* native_object() override;
         i_timer_object& create_timer_object() override;
         void remove_timer_object(i_timer_object& aObject) override;
+        std::optional<std::chrono::steady_clock::time_point> next_deadline() const override;
+        void deadline_changed(i_timer_object& aObject) override;
+        // implementation
+    private:
+        std::uint64_t tick(std::chrono::steady_clock::time_point aTime, bool aRoundUp) const;
+        std::chrono::steady_clock::time_point time(std::uint64_t aTick) const;
+        std::optional<std::uint64_t> next_tick() const;
+        void link(timer_object& aObject);
+        void link(timer_object& aObject, std::uint32_t aList);
+        void unlink(timer_object& aObject);
+        timer_object* take(std::uint32_t aList);
+        std::optional<std::uint32_t> next_occupied(std::uint32_t aLevel) const;
+        void advance(std::uint64_t aTick);
+        void cascade();
         // attributes
     private:
         async_task& iTask;
         destroying_flag iTaskDestroying;
         mutable std::recursive_mutex iMutex;
         std::vector<ref_ptr<i_timer_object>> iObjects;
+        std::chrono::steady_clock::time_point const iEpoch;
+        std::uint64_t iCurrentTick;
+        std::size_t iWheelCount;
+        std::array<timer_object*, kWheelLists> iLists;
+        std::array<std::array<std::uint64_t, kWheelSlots / 64u>, kWheelLevels> iOccupied;
     };
 
     enum class async_task_state
@@ -114,8 +153,14 @@ namespace neolib
         i_message_queue& message_queue() override;
         void register_event_queue(i_async_event_queue& aQueue) override;
         void unregister_event_queue(i_async_event_queue& aQueue) override;
+        void event_queue_ready(i_async_event_queue& aQueue) override;
         bool pump_events() override;
         bool pump_messages() override;
+        void post(std::function<void()> aFunction) override;
+        void wake() override;
+        // in reactor mode run() blocks between bursts of work rather than polling (yield_type::Wait)
+        bool reactor_mode() const noexcept;
+        void set_reactor_mode(bool aReactorMode);
         bool running() const noexcept override;
         bool halted() const noexcept override;
         void halt() override;
@@ -131,6 +176,12 @@ namespace neolib
         bool do_work(yield_type aYieldType = yield_type::NoYield) override;
         void cancel() noexcept override;
         void idle() override;
+    private:
+        bool pump_posted();
+        i_async_event_queue* take_ready_event_queues();
+        void push_ready_event_queues(i_async_event_queue* aQueues);
+        void wait_for_work();
+        void set_state(async_task_state aState);
         // attributes
     private:
         std::recursive_mutex iMutex;
@@ -139,6 +190,17 @@ namespace neolib
         std::unique_ptr<i_async_service> iIoService;
         message_queue_pointer iMessageQueue;
         std::vector<i_async_event_queue*> iEventQueues;
+        std::atomic<i_async_event_queue*> iReadyEventQueues;
+        std::mutex iPostedMutex;
+        std::vector<std::function<void()>> iPosted;
+        std::atomic<bool> iReactorMode;
+        std::atomic<bool> iBlocked;
+        std::atomic<bool> iWakeRequested;
+        std::atomic<bool> iWakeSignalled;
+        std::mutex iWakeMutex;
+        std::condition_variable iWakeConditionVariable;
         std::atomic<async_task_state> iState;
+        mutable std::mutex iStateMutex;
+        mutable std::condition_variable iStateChanged;
     };
 }
@@ -0,0 +1,553 @@
+// coroutine.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <neolib/task/thread_pool.hpp>
+#include <neolib/task/task_future.hpp>
+#include <neolib/task/i_async_task.hpp>
+#include <neolib/task/i_timer_object.hpp>
+#include <neolib/task/i_event.hpp>
+
+namespace neolib
+{
+    // Coroutine frames are recycled through per-thread, size-class free lists so that starting a
+    // coroutine does not normally reach the global heap.
+    class NEOLIB_EXPORT coroutine_frame_pool
+    {
+        // constants
+    public:
+        static constexpr std::size_t kGranularity = 64;
+        static constexpr std::size_t kMaxPooledFrameSize = 4096;
+        static constexpr std::size_t kMaxCachedFramesPerSize = 64;
+        // operations
+    public:
+        static void* allocate(std::size_t aSize);
+        static void deallocate(void* aFrame, std::size_t aSize) noexcept;
+    };
+
+    template <typename T = void>
+    class coroutine;
+
+    namespace detail
+    {
+        struct pooled_coroutine_frame
+        {
+            static void* operator new(std::size_t aSize)
+            {
+                return coroutine_frame_pool::allocate(aSize);
+            }
+            static void operator delete(void* aFrame, std::size_t aSize) noexcept
+            {
+                coroutine_frame_pool::deallocate(aFrame, aSize);
+            }
+        };
+
+        template <typename T>
+        struct coroutine_return
+        {
+            std::optional<T> result;
+
+            template <typename U>
+            void return_value(U&& aValue)
+            {
+                result.emplace(std::forward<U>(aValue));
+            }
+        };
+
+        template <>
+        struct coroutine_return<void>
+        {
+            void return_void() noexcept
+            {
+            }
+        };
+
+        template <typename T>
+        struct coroutine_promise : pooled_coroutine_frame, coroutine_return<T>
+        {
+            struct final_awaiter
+            {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<coroutine_promise> aHandle) noexcept
+                {
+                    if (aHandle.promise().continuation)
+                        return aHandle.promise().continuation;
+                    return std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+
+            coroutine<T> get_return_object() noexcept;
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            final_awaiter final_suspend() noexcept { return {}; }
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+        };
+
+        // Starts immediately and destroys itself on completion; used to drive a coroutine from
+        // non-coroutine code.
+        struct detached_coroutine
+        {
+            struct promise_type : pooled_coroutine_frame
+            {
+                detached_coroutine get_return_object() noexcept { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() noexcept {}
+                void unhandled_exception() noexcept { std::terminate(); }
+            };
+        };
+
+        // Rendezvous between an awaiting coroutine and whatever completes the awaited operation; the
+        // latter may run on another thread and even before await_suspend() has returned.
+        template <typename Result>
+        class awaited_result
+        {
+            enum state : int
+            {
+                Pending,
+                Suspended,
+                Completed
+            };
+        public:
+            bool suspend(std::coroutine_handle<> aHandle)
+            {
+                iHandle = aHandle;
+                return iState.exchange(Suspended, std::memory_order_acq_rel) != Completed;
+            }
+            template <typename... Values>
+            void complete(Values&&... aValues)
+            {
+                if (iClaimed.exchange(true, std::memory_order_acq_rel))
+                    return;
+                if constexpr (!std::is_void_v<Result>)
+                    iResult.emplace(std::forward<Values>(aValues)...);
+                resume();
+            }
+            void fail(std::exception_ptr aException)
+            {
+                if (iClaimed.exchange(true, std::memory_order_acq_rel))
+                    return;
+                iException = aException;
+                resume();
+            }
+            Result take()
+            {
+                if (iException)
+                    std::rethrow_exception(iException);
+                if constexpr (!std::is_void_v<Result>)
+                    return std::move(*iResult);
+            }
+            // event subscriptions made by the awaiter; the awaiter removes them once resumed (or destroyed)
+            void subscribe(ref_ptr<i_slot_base> aSlot)
+            {
+                iSlots.push_back(std::move(aSlot));
+            }
+            void unsubscribe()
+            {
+                for (auto& slot : iSlots)
+                    slot->remove();
+                iSlots.clear();
+            }
+        private:
+            void resume()
+            {
+                if (iState.exchange(Completed, std::memory_order_acq_rel) == Suspended)
+                    iHandle.resume();
+            }
+        private:
+            std::atomic<int> iState = Pending;
+            std::atomic<bool> iClaimed = false;
+            std::coroutine_handle<> iHandle;
+            std::optional<task_result_t<Result>> iResult;
+            std::exception_ptr iException;
+            std::vector<ref_ptr<i_slot_base>> iSlots;
+        };
+
+        // Base for awaiters completed through an awaited_result; start() begins the operation and must
+        // not touch the awaiter once completion is possible.
+        template <typename Result>
+        class callback_awaiter
+        {
+        protected:
+            typedef awaited_result<Result> result_type;
+        public:
+            callback_awaiter() :
+                iResult{ std::make_shared<result_type>() }
+            {
+            }
+            callback_awaiter(callback_awaiter&&) = default;
+            ~callback_awaiter()
+            {
+                if (iResult)
+                    iResult->unsubscribe();
+            }
+        public:
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+            Result await_resume()
+            {
+                iResult->unsubscribe();
+                return iResult->take();
+            }
+        protected:
+            std::shared_ptr<result_type> iResult;
+        };
+
+        template <typename... Args>
+        struct event_result
+        {
+            typedef std::tuple<std::decay_t<Args>...> type;
+        };
+
+        template <>
+        struct event_result<>
+        {
+            typedef void type;
+        };
+
+        template <typename Arg>
+        struct event_result<Arg>
+        {
+            typedef std::decay_t<Arg> type;
+        };
+    }
+
+    // A lazily started coroutine returning T. co_await-ing it starts it and resumes the awaiter
+    // (without recursion) when it completes; use spawn() to start one from ordinary code.
+    template <typename T>
+    class coroutine
+    {
+        // types
+    public:
+        typedef T value_type;
+        typedef detail::coroutine_promise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> handle_type;
+        // exceptions
+    public:
+        struct empty_coroutine : std::logic_error { empty_coroutine() : std::logic_error{ "neolib::coroutine::empty_coroutine" } {} };
+    private:
+        struct awaiter
+        {
+            handle_type handle;
+
+            bool await_ready() const noexcept
+            {
+                return !handle || handle.done();
+            }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> aAwaiter) noexcept
+            {
+                handle.promise().continuation = aAwaiter;
+                return handle;
+            }
+            T await_resume()
+            {
+                if (!handle)
+                    throw empty_coroutine();
+                auto& promise = handle.promise();
+                if (promise.exception)
+                    std::rethrow_exception(promise.exception);
+                if constexpr (!std::is_void_v<T>)
+                    return std::move(*promise.result);
+            }
+        };
+        // construction
+    public:
+        coroutine() noexcept = default;
+        explicit coroutine(handle_type aHandle) noexcept :
+            iHandle{ aHandle }
+        {
+        }
+        coroutine(coroutine&& aOther) noexcept :
+            iHandle{ std::exchange(aOther.iHandle, {}) }
+        {
+        }
+        coroutine& operator=(coroutine&& aOther) noexcept
+        {
+            if (this != &aOther)
+            {
+                if (iHandle)
+                    iHandle.destroy();
+                iHandle = std::exchange(aOther.iHandle, {});
+            }
+            return *this;
+        }
+        ~coroutine()
+        {
+            if (iHandle)
+                iHandle.destroy();
+        }
+        // operations
+    public:
+        bool valid() const noexcept
+        {
+            return static_cast<bool>(iHandle);
+        }
+        bool done() const noexcept
+        {
+            return !iHandle || iHandle.done();
+        }
+        awaiter operator co_await() const noexcept
+        {
+            return awaiter{ iHandle };
+        }
+        // attributes
+    private:
+        handle_type iHandle;
+    };
+
+    template <typename T>
+    inline coroutine<T> detail::coroutine_promise<T>::get_return_object() noexcept
+    {
+        return coroutine<T>{ std::coroutine_handle<coroutine_promise>::from_promise(*this) };
+    }
+
+    // Resumes the awaiting coroutine on a thread_pool thread.
+    struct thread_pool_awaitable
+    {
+        thread_pool& pool;
+        int32_t priority;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        bool await_suspend(std::coroutine_handle<> aHandle)
+        {
+            // resume inline if the pool has been stopped
+            return pool.post([aHandle]() { aHandle.resume(); }, priority);
+        }
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    // Resumes the awaiting coroutine on an async_task's thread (from the task's do_work()).
+    struct async_task_awaitable
+    {
+        i_async_task& task;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> aHandle)
+        {
+            task.post([aHandle]() { aHandle.resume(); });
+        }
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    // Resumes the awaiting coroutine on a thread_pool thread once a delay has elapsed.
+    struct thread_pool_delay_awaitable
+    {
+        thread_pool& pool;
+        std::chrono::steady_clock::duration delay;
+        int32_t priority;
+
+        bool await_ready() const noexcept
+        {
+            return delay <= std::chrono::steady_clock::duration::zero();
+        }
+        bool await_suspend(std::coroutine_handle<> aHandle)
+        {
+            // resume inline if the pool has been stopped
+            return pool.run_after(delay, [aHandle]() { aHandle.resume(); }, priority) != nullptr;
+        }
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    // Resumes the awaiting coroutine on an async_task's thread when a timer on that task expires.
+    class async_task_delay_awaitable : public detail::callback_awaiter<void>
+    {
+    public:
+        async_task_delay_awaitable(i_async_task& aTask, std::chrono::steady_clock::duration aDelay) :
+            iTask{ aTask }, iDelay{ aDelay }
+        {
+        }
+    public:
+        bool await_suspend(std::coroutine_handle<> aHandle)
+        {
+            // the timer object belongs to the task's timer service so is created on the task's thread
+            iTask.post([&task = iTask, delay = iDelay, result = iResult]()
+            {
+                auto& timerObject = task.timer_service().create_timer_object();
+                timerObject.expires_from_now(delay);
+                timerObject.async_wait([&task, result](i_timer_object& aTimerObject)
+                {
+                    task.timer_service().remove_timer_object(aTimerObject);
+                    result->complete();
+                });
+            });
+            return iResult->suspend(aHandle);
+        }
+    private:
+        i_async_task& iTask;
+        std::chrono::steady_clock::duration iDelay;
+    };
+
+    // Resumes the awaiting coroutine with the arguments of the next trigger of an event. The coroutine
+    // is resumed on the triggering thread; co_await resume_on(...) to continue elsewhere.
+    template <typename... Args>
+    class event_awaitable : public detail::callback_awaiter<typename detail::event_result<Args...>::type>
+    {
+        typedef detail::callback_awaiter<typename detail::event_result<Args...>::type> base_type;
+    public:
+        explicit event_awaitable(i_event<Args...> const& aEvent) :
+            iEvent{ aEvent }
+        {
+        }
+    public:
+        bool await_suspend(std::coroutine_handle<> aHandle)
+        {
+            auto& result = base_type::iResult;
+            result->subscribe(make_ref<slot<Args...>>(iEvent, [result = std::weak_ptr{ result }](Args... aArgs)
+            {
+                if (auto r = result.lock())
+                    r->complete(aArgs...);
+            }, true));
+            return result->suspend(aHandle);
+        }
+    private:
+        i_event<Args...> const& iEvent;
+    };
+
+    inline thread_pool_awaitable resume_on(thread_pool& aThreadPool, int32_t aPriority = 0)
+    {
+        return thread_pool_awaitable{ aThreadPool, aPriority };
+    }
+
+    inline async_task_awaitable resume_on(i_async_task& aTask)
+    {
+        return async_task_awaitable{ aTask };
+    }
+
+    template <typename Rep, typename Period>
+    inline thread_pool_delay_awaitable resume_after(thread_pool& aThreadPool, std::chrono::duration<Rep, Period> const& aDelay, int32_t aPriority = 0)
+    {
+        return thread_pool_delay_awaitable{ aThreadPool, std::chrono::duration_cast<std::chrono::steady_clock::duration>(aDelay), aPriority };
+    }
+
+    template <typename Rep, typename Period>
+    inline async_task_delay_awaitable resume_after(i_async_task& aTask, std::chrono::duration<Rep, Period> const& aDelay)
+    {
+        return async_task_delay_awaitable{ aTask, std::chrono::duration_cast<std::chrono::steady_clock::duration>(aDelay) };
+    }
+
+    template <typename... Args>
+    inline event_awaitable<Args...> next_event(i_event<Args...> const& aEvent)
+    {
+        return event_awaitable<Args...>{ aEvent };
+    }
+
+    template <typename T>
+    inline auto operator co_await(task_future<T> const& aFuture)
+    {
+        struct awaiter
+        {
+            task_future<T> future;
+
+            bool await_ready() const
+            {
+                return future.ready();
+            }
+            void await_suspend(std::coroutine_handle<> aHandle)
+            {
+                future.state().on_ready([aHandle]() { aHandle.resume(); }, 0);
+            }
+            decltype(auto) await_resume() const
+            {
+                return future.get();
+            }
+        };
+        return awaiter{ aFuture };
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        inline detached_coroutine drive(thread_pool& aThreadPool, int32_t aPriority, coroutine<T> aCoroutine, std::shared_ptr<task_future_state<T>> aState)
+        {
+            co_await resume_on(aThreadPool, aPriority);
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    co_await aCoroutine;
+                    aState->set_value({});
+                }
+                else
+                    aState->set_value(co_await aCoroutine);
+            }
+            catch (...)
+            {
+                aState->set_exception(std::current_exception());
+            }
+        }
+    }
+
+    // Starts a coroutine on a thread_pool; the returned future completes when the coroutine does.
+    template <typename T>
+    inline task_future<T> spawn(thread_pool& aThreadPool, coroutine<T> aCoroutine, int32_t aPriority = 0)
+    {
+        auto state = std::make_shared<detail::task_future_state<T>>(aThreadPool);
+        detail::drive(aThreadPool, aPriority, std::move(aCoroutine), state);
+        return task_future<T>{ state };
+    }
+
+    template <typename T>
+    inline task_future<T> spawn(coroutine<T> aCoroutine, int32_t aPriority = 0)
+    {
+        return spawn(thread_pool::default_thread_pool(), std::move(aCoroutine), aPriority);
+    }
+}
@@ -36,30 +36,62 @@
 #pragma once
 
 #include <neolib/neolib.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
 #include <vector>
-#include <boost/unordered/unordered_flat_map.hpp>
+#include <version>
 #include <neolib/core/lifetime.hpp>
 #include <neolib/core/scoped.hpp>
 #include <neolib/task/i_async_task.hpp>
 #include <neolib/task/i_event.hpp>
+#include <neolib/task/event_tracing.hpp>
 
 namespace neolib
 {
+    // A multiple producer, single consumer (the owning thread) queue of slot calls. Producers
+    // never lock or block: each call and its arguments are stored in an entry taken from a
+    // per-queue arena (recycled through a lock-free free list) and linked into an intrusive
+    // queue (Vyukov); pump_events drains the queue in batches. For slots not accepting
+    // duplicates only the most recently queued call is made. Only the enqueue that finds the
+    // queue not ready tells the owning task, which then pumps just its ready queues.
     class async_event_queue : public lifetime<i_async_event_queue>
     {
     private:
         struct queue_entry
         {
-            void const* event;
-            destroyed_flag eventDestroyed;
-            void const* slot;
-            destroyed_flag slotDestroyed;
-            std::function<void()> callback;
+            static constexpr std::size_t kStorageSize = 64u;
+
+            std::atomic<queue_entry*> next;
+            std::atomic<std::uint32_t> nextFree;
+            std::uint32_t index;
+            i_slot_base* slot;
+            std::uint64_t sequence;
+            void(*invoke)(queue_entry&);
+            void(*destroy)(queue_entry&);
+            alignas(std::max_align_t) std::byte storage[kStorageSize];
         };
-        struct queue
+        class entry_arena
         {
-            std::vector<queue_entry> multiple;
-            boost::unordered_flat_map<std::pair<void const*, void const*>, queue_entry> single;
+        public:
+            static constexpr std::uint32_t kFirstChunkBits = 6u;
+            static constexpr std::uint32_t kMaxChunks = 26u;
+        public:
+            entry_arena();
+            ~entry_arena();
+        public:
+            queue_entry& allocate();
+            void deallocate(queue_entry& aEntry);
+        private:
+            queue_entry& at(std::uint32_t aIndex);
+        private:
+            // free list head: ABA tag in the upper 32 bits, entry index + 1 in the lower 32 bits
+            std::atomic<std::uint64_t> iFree;
+            std::atomic<std::uint32_t> iNextUnused;
+            std::array<std::atomic<queue_entry*>, kMaxChunks> iChunks;
         };
     public:
         static async_event_queue& instance();
@@ -71,37 +103,115 @@ namespace neolib
         template <typename... Args>
         void enqueue(i_slot<Args...>& aSlot, bool aNoDuplicates, Args... aArgs)
         {
-            std::scoped_lock lock{ event_mutex() };
-            auto& event = aSlot.event();
-            std::tuple<Args...> args{ aArgs... };
-            auto callback = [&, args]()
-            {
-                std::apply([&](Args... aArgs) { aSlot.call(aArgs...); }, args);
-            };
-            bool const single = (aNoDuplicates || aSlot.stateless());
-            if (single)
+            typedef std::tuple<Args...> payload;
+            auto& entry = iArena.allocate();
+            aSlot.add_ref();
+            entry.slot = &aSlot;
+            entry.sequence = (aNoDuplicates || aSlot.stateless()) ? aSlot.next_enqueue_sequence() : 0u;
+            if constexpr (sizeof(payload) <= queue_entry::kStorageSize && alignof(payload) <= alignof(std::max_align_t))
             {
-                typename decltype(iQueue.single)::key_type const key{ &event, &aSlot };
-                auto existing = iQueue.single.find(key);
-                if (existing != iQueue.single.end())
+                new (entry.storage) payload{ aArgs... };
+                entry.invoke = [](queue_entry& aEntry)
                 {
-                    existing->second.callback = callback;
-                    return;
-                }
-                iQueue.single.emplace(key, queue_entry{ &event, event, &aSlot, aSlot, callback });
+                    std::apply([&](auto&&... aArgs) { static_cast<i_slot<Args...>&>(*aEntry.slot).call(aArgs...); }, 
+                        *std::launder(reinterpret_cast<payload*>(aEntry.storage)));
+                };
+                entry.destroy = [](queue_entry& aEntry)
+                {
+                    std::launder(reinterpret_cast<payload*>(aEntry.storage))->~payload();
+                };
             }
             else
-                iQueue.multiple.emplace_back(&event, event, &aSlot, aSlot, callback);
+            {
+                new (entry.storage) payload*{ new payload{ aArgs... } };
+                entry.invoke = [](queue_entry& aEntry)
+                {
+                    std::apply([&](auto&&... aArgs) { static_cast<i_slot<Args...>&>(*aEntry.slot).call(aArgs...); },
+                        **std::launder(reinterpret_cast<payload**>(aEntry.storage)));
+                };
+                entry.destroy = [](queue_entry& aEntry)
+                {
+                    delete *std::launder(reinterpret_cast<payload**>(aEntry.storage));
+                };
+            }
+            push(entry);
+            ready();
         }
+        void enqueue_delivery(i_slot_base& aSlot);
     public:
         void register_with_task(i_async_task& aTask) final;
+        bool have_events() const final;
         bool pump_events() final;
+    public:
+        i_async_event_queue* next_ready() const final;
+        void set_next_ready(i_async_event_queue* aNext) final;
+        void reset_ready() final;
+    public:
+        std::shared_ptr<async_event_queue_handle> const& handle() const;
+    private:
+        void push(queue_entry& aEntry);
+        queue_entry* pop();
+        void release(queue_entry& aEntry);
+        void ready();
     private:
         i_async_task* iTask = nullptr;
         std::optional<destroyed_flag> iTaskDestroyed;
-        queue iQueue;
+        std::shared_ptr<async_event_queue_handle> iHandle;
+        std::atomic<bool> iReady;
+        i_async_event_queue* iNextReady;
+        entry_arena iArena;
+        queue_entry iStub;
+        alignas(BOOST_LOCKFREE_CACHELINE_BYTES) std::atomic<queue_entry*> iTail;
+        alignas(BOOST_LOCKFREE_CACHELINE_BYTES) queue_entry* iHead;
     };
 
+    // A thread's event queue as cached by the slots that call into it; usable from any thread and
+    // remains valid after the queue is destroyed at thread exit (calls are then discarded).
+    class async_event_queue_handle
+    {
+        friend class async_event_queue;
+    public:
+        async_event_queue_handle(async_event_queue& aQueue) :
+            iQueue{ &aQueue },
+            iUsers{ 0u }
+        {
+        }
+    public:
+        template <typename... Args>
+        bool enqueue(i_slot<Args...>& aSlot, bool aNoDuplicates, Args... aArgs)
+        {
+            // sequentially consistent so that close() either sees this user or we see the queue gone
+            iUsers.fetch_add(1u);
+            auto const queue = iQueue.load();
+            try
+            {
+                if (queue != nullptr)
+                    queue->enqueue<Args...>(aSlot, aNoDuplicates, aArgs...);
+            }
+            catch (...)
+            {
+                iUsers.fetch_sub(1u);
+                throw;
+            }
+            iUsers.fetch_sub(1u);
+            return queue != nullptr;
+        }
+        bool enqueue_delivery(i_slot_base& aSlot);
+    private:
+        void close()
+        {
+            iQueue.store(nullptr);
+            while (iUsers.load() != 0u)
+                std::this_thread::yield();
+        }
+    private:
+        std::atomic<async_event_queue*> iQueue;
+        std::atomic<std::uint32_t> iUsers;
+    };
+
+    // The slot list is an immutable snapshot replaced wholesale (copy-on-write) when a slot is
+    // added or removed; triggering takes a reference to the current snapshot without locking
+    // or copying it so concurrent triggers of the same event do not contend.
     template <typename... Args>
     class event : public lifetime<i_event<Args...>>
     {
@@ -111,10 +221,12 @@ namespace neolib
         using typename base_type::abstract_type;
     private:
         typedef std::vector<ref_ptr<i_slot<Args...>>> slot_list;
-        struct work_list
+        typedef std::shared_ptr<slot_list const> slot_list_pointer;
+        struct trigger_frame
         {
-            slot_list slots;
-            bool accepted = false;
+            self_type const* event;
+            trigger_frame* previous;
+            bool accepted;
         };
     public:
         event()
@@ -122,6 +234,8 @@ namespace neolib
         }
         ~event()
         {
+            // slots released here may try to remove themselves from this event
+            auto const slots = exchange_slots(nullptr);
         }
     public:
         neolib::trigger_type trigger_type() const final
@@ -135,74 +249,139 @@ namespace neolib
     public:
         trigger_result sync_trigger(Args... aArgs) const final
         {
-            std::unique_lock lock{ event_mutex() };
+            event_tracing::trigger_trace<> trace{ this, false };
+            auto const slots = load_slots(std::memory_order_acquire);
+            if (slots == nullptr)
+                return trigger_result::Unaccepted;
             destroyed_flag destroyed{ *this };
-            thread_local std::size_t stack;
-            scoped_counter<std::size_t> stackCounter{ stack };
-            thread_local std::vector<std::unique_ptr<work_list>> workLists;
-            if (workLists.size() < stack)
-                workLists.push_back(std::make_unique<work_list>());
-            auto& workList = *workLists[stack - 1];
-            scoped_pointer<work_list> activeWorkList{ iActiveWorkList, &workList };
-            workList.slots = iSlots;
-            lock.unlock();
-            for (auto slot : workList.slots)
+            trigger_frame frame{ this, active_frame(), false };
+            scoped_pointer<trigger_frame> activeFrame{ active_frame(), &frame };
+            for (auto const& slot : *slots)
             {
                 if (slot->call_in_emitter_thread() || slot->call_thread() == std::this_thread::get_id())
+                {
+                    trace.slot_called();
                     slot->call(aArgs...);
+                }
                 else
-                    async_trigger(async_event_queue::instance(slot->call_thread()), *slot, trigger_type() == neolib::trigger_type::SynchronousDontQueue, aArgs...);
+                {
+                    trace.call_queued();
+                    async_trigger(*slot, trigger_type() == neolib::trigger_type::SynchronousDontQueue, aArgs...);
+                }
                 if (destroyed)
                     return trigger_result::Unaccepted;
-                if (workList.accepted)
-                {
-                    workList.accepted = false;
+                if (frame.accepted)
                     return trigger_result::Accepted;
-                }
             }
-            workList.slots.clear();
-            workList.accepted = false;
             return trigger_result::Unaccepted;
         }
         void async_trigger(Args... aArgs) const final
         {
-            std::unique_lock lock{ event_mutex() };
-            for (auto slot : iSlots)
-                async_trigger(async_event_queue::instance(slot->call_thread()), *slot, trigger_type() == neolib::trigger_type::AsynchronousDontQueue, aArgs...);
+            event_tracing::trigger_trace<> trace{ this, true };
+            auto const slots = load_slots(std::memory_order_acquire);
+            if (slots == nullptr)
+                return;
+            for (auto const& slot : *slots)
+            {
+                trace.call_queued();
+                async_trigger(*slot, trigger_type() == neolib::trigger_type::AsynchronousDontQueue, aArgs...);
+            }
         }
         void accept() const final
         {
-            std::unique_lock lock{ event_mutex() };
-            if (iActiveWorkList)
-                iActiveWorkList->accepted = true;
+            // accepts the innermost trigger of this event on the calling thread
+            for (auto frame = active_frame(); frame != nullptr; frame = frame->previous)
+                if (frame->event == this)
+                {
+                    frame->accepted = true;
+                    return;
+                }
         }
     public:
         bool has_slots() const final
         {
-            std::scoped_lock lock{ event_mutex() };
-            return !iSlots.empty();
+            return load_slots(std::memory_order_acquire) != nullptr;
         }
         void add_slot(i_slot<Args...>& aSlot) const final
         {
-            std::scoped_lock lock{ event_mutex() };
-            iSlots.push_back(&aSlot);
+            std::scoped_lock lock{ iSlotsLock };
+            auto const existing = load_slots(std::memory_order_relaxed);
+            auto updated = std::make_shared<slot_list>();
+            if (existing != nullptr)
+            {
+                updated->reserve(existing->size() + 1u);
+                updated->assign(existing->begin(), existing->end());
+            }
+            updated->push_back(&aSlot);
+            store_slots(std::move(updated));
         }
         void remove_slot(i_slot<Args...>& aSlot) const final
         {
-            std::scoped_lock lock{ event_mutex() };
-            auto existing = std::find_if(iSlots.begin(), iSlots.end(), [&](auto const& s) { return &aSlot == s.ptr(); });
-            if (existing != iSlots.end())
-                iSlots.erase(existing);
+            std::scoped_lock lock{ iSlotsLock };
+            auto const existing = load_slots(std::memory_order_relaxed);
+            if (existing == nullptr)
+                return;
+            auto const slot = std::find_if(existing->begin(), existing->end(), [&](auto const& s) { return &aSlot == s.ptr(); });
+            if (slot == existing->end())
+                return;
+            if (existing->size() == 1u)
+            {
+                store_slots(nullptr);
+                return;
+            }
+            auto updated = std::make_shared<slot_list>();
+            updated->reserve(existing->size() - 1u);
+            updated->insert(updated->end(), existing->begin(), slot);
+            updated->insert(updated->end(), std::next(slot), existing->end());
+            store_slots(std::move(updated));
         }
     private:
-        void async_trigger(async_event_queue& aQueue, i_slot<Args...>& aSlot, bool aNoDuplicates, Args... aArgs) const
+        void async_trigger(i_slot<Args...>& aSlot, bool aNoDuplicates, Args... aArgs) const
+        {
+            if (aSlot.delivery() == slot_delivery::Queued)
+                aSlot.call_queue().template enqueue<Args...>(aSlot, aNoDuplicates, aArgs...);
+            else if (aSlot.accumulate(aArgs...))
+                aSlot.call_queue().enqueue_delivery(aSlot);
+        }
+        static trigger_frame*& active_frame()
+        {
+            thread_local trigger_frame* tActiveFrame;
+            return tActiveFrame;
+        }
+        // std::atomic<std::shared_ptr> isn't available everywhere (e.g. libc++) so fall back to the
+        // atomic free functions for shared_ptr there
+        slot_list_pointer load_slots(std::memory_order aOrder) const
+        {
+#ifdef __cpp_lib_atomic_shared_ptr
+            return iSlots.load(aOrder);
+#else
+            return std::atomic_load_explicit(&iSlots, aOrder);
+#endif
+        }
+        void store_slots(slot_list_pointer aSlots) const
+        {
+#ifdef __cpp_lib_atomic_shared_ptr
+            iSlots.store(std::move(aSlots), std::memory_order_release);
+#else
+            std::atomic_store_explicit(&iSlots, std::move(aSlots), std::memory_order_release);
+#endif
+        }
+        slot_list_pointer exchange_slots(slot_list_pointer aSlots) const
         {
-            aQueue.enqueue<Args...>(aSlot, aNoDuplicates, aArgs...);
+#ifdef __cpp_lib_atomic_shared_ptr
+            return iSlots.exchange(std::move(aSlots), std::memory_order_acq_rel);
+#else
+            return std::atomic_exchange_explicit(&iSlots, std::move(aSlots), std::memory_order_acq_rel);
+#endif
         }
     private:
         neolib::trigger_type iTriggerType = neolib::trigger_type::Synchronous;
-        mutable slot_list iSlots;
-        mutable work_list* iActiveWorkList = nullptr;
+        mutable spinlock iSlotsLock;
+#ifdef __cpp_lib_atomic_shared_ptr
+        mutable std::atomic<slot_list_pointer> iSlots;
+#else
+        mutable slot_list_pointer iSlots;
+#endif
     };
 
     #define define_declared_event( name, declName, ... ) \
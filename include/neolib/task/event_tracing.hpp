@@ -0,0 +1,162 @@
+// event_tracing.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+namespace neolib
+{
+    // Optional instrumentation of event triggers and event queue pumps, compiled in when
+    // NEOLIB_EVENT_TRACING is defined (the NEOLIB_EVENT_TRACING CMake option defines it for
+    // the library and its users). Statistics are accumulated per thread and merged when a
+    // snapshot is taken so tracing does not add contention between triggering threads.
+    namespace event_tracing
+    {
+#ifdef NEOLIB_EVENT_TRACING
+        inline constexpr bool enabled = true;
+#else
+        inline constexpr bool enabled = false;
+#endif
+
+        struct event_statistics
+        {
+            std::uint64_t syncTriggers = 0u;
+            std::uint64_t asyncTriggers = 0u;
+            // slots called directly by synchronous triggers
+            std::uint64_t slotCalls = 0u;
+            // slot calls queued to other threads by synchronous and asynchronous triggers
+            std::uint64_t queuedCalls = 0u;
+            std::chrono::nanoseconds dispatchTime = {};
+        };
+
+        struct queue_statistics
+        {
+            // pumps that made at least one call
+            std::uint64_t pumps = 0u;
+            std::uint64_t calls = 0u;
+            std::chrono::nanoseconds dispatchTime = {};
+        };
+
+        // events are identified by address
+        typedef std::unordered_map<void const*, event_statistics> event_statistics_map;
+
+        NEOLIB_EXPORT void record_trigger(void const* aEvent, bool aAsync, std::uint64_t aSlotCalls, std::uint64_t aQueuedCalls, std::chrono::nanoseconds aDispatchTime);
+        NEOLIB_EXPORT void record_pump(std::uint64_t aCalls, std::chrono::nanoseconds aDispatchTime);
+        NEOLIB_EXPORT event_statistics_map event_snapshot();
+        NEOLIB_EXPORT queue_statistics queue_snapshot();
+        NEOLIB_EXPORT void reset();
+
+        template <bool Enabled = enabled>
+        class trigger_trace
+        {
+        public:
+            trigger_trace(void const*, bool)
+            {
+            }
+        public:
+            void slot_called()
+            {
+            }
+            void call_queued()
+            {
+            }
+        };
+
+        template <>
+        class trigger_trace<true>
+        {
+        public:
+            trigger_trace(void const* aEvent, bool aAsync) :
+                iEvent{ aEvent }, iAsync{ aAsync }, iSlotCalls{ 0u }, iQueuedCalls{ 0u }, iStart{ std::chrono::steady_clock::now() }
+            {
+            }
+            ~trigger_trace()
+            {
+                record_trigger(iEvent, iAsync, iSlotCalls, iQueuedCalls, std::chrono::steady_clock::now() - iStart);
+            }
+        public:
+            void slot_called()
+            {
+                ++iSlotCalls;
+            }
+            void call_queued()
+            {
+                ++iQueuedCalls;
+            }
+        private:
+            void const* iEvent;
+            bool iAsync;
+            std::uint64_t iSlotCalls;
+            std::uint64_t iQueuedCalls;
+            std::chrono::steady_clock::time_point iStart;
+        };
+
+        template <bool Enabled = enabled>
+        class pump_trace
+        {
+        public:
+            void call_made()
+            {
+            }
+        };
+
+        template <>
+        class pump_trace<true>
+        {
+        public:
+            pump_trace() :
+                iCalls{ 0u }, iStart{ std::chrono::steady_clock::now() }
+            {
+            }
+            ~pump_trace()
+            {
+                if (iCalls != 0u)
+                    record_pump(iCalls, std::chrono::steady_clock::now() - iStart);
+            }
+        public:
+            void call_made()
+            {
+                ++iCalls;
+            }
+        private:
+            std::uint64_t iCalls;
+            std::chrono::steady_clock::time_point iStart;
+        };
+    }
+}
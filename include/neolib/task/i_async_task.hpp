@@ -36,6 +36,8 @@
 #pragma once
 
 #include <neolib/neolib.hpp>
+#include <chrono>
+#include <optional>
 #include <neolib/app/services.hpp>
 #include <neolib/task/i_thread.hpp>
 #include <neolib/task/i_message_queue.hpp>
@@ -82,6 +84,8 @@ namespace neolib
     public:
         virtual i_timer_object& create_timer_object() = 0;
         virtual void remove_timer_object(i_timer_object& aObject) = 0;
+        virtual std::optional<std::chrono::steady_clock::time_point> next_deadline() const = 0;
+        virtual void deadline_changed(i_timer_object& aObject) = 0;
     };
 
     class i_async_task : public i_task, public i_service, public i_reference_counted
@@ -112,8 +116,14 @@ namespace neolib
         virtual i_message_queue& message_queue() = 0;
         virtual void register_event_queue(i_async_event_queue& aQueue) = 0;
         virtual void unregister_event_queue(i_async_event_queue& aQueue) = 0;
+        // called from any thread when a registered event queue that was empty has events
+        virtual void event_queue_ready(i_async_event_queue& aQueue) = 0;
         virtual bool pump_events() = 0;
         virtual bool pump_messages() = 0;
+        // aFunction will be called on the task's thread by its next do_work()
+        virtual void post(std::function<void()> aFunction) = 0;
+        // interrupts a do_work(yield_type::Wait) that is blocked (or about to block) waiting for work
+        virtual void wake() = 0;
         virtual bool running() const noexcept = 0;
         virtual bool halted() const noexcept = 0;
         virtual void halt() = 0;
@@ -37,6 +37,11 @@
 
 #include <neolib/neolib.hpp>
 #include <functional>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 #include <neolib/core/mutex.hpp>
 #include <neolib/core/lifetime.hpp>
 #include <neolib/core/reference_counted.hpp>
@@ -68,11 +73,23 @@ namespace neolib
     {
     public:
         virtual void register_with_task(i_async_task& aTask) = 0;
+        virtual bool have_events() const = 0;
         virtual bool pump_events() = 0;
+    public:
+        // a queue with pending events is linked (once) into its task's ready list; the task
+        // resets the queue before pumping it so that the next event makes it ready again
+        virtual i_async_event_queue* next_ready() const = 0;
+        virtual void set_next_ready(i_async_event_queue* aNext) = 0;
+        virtual void reset_ready() = 0;
     };
 
     template <typename... Args>
     class i_event;
+
+    class async_event_queue_handle;
+
+    // handle to the calling thread's event queue which is created on first use
+    NEOLIB_EXPORT std::shared_ptr<async_event_queue_handle> const& this_thread_event_queue();
         
     class i_slot_base : public i_reference_counted, public i_lifetime
     {
@@ -80,6 +97,21 @@ namespace neolib
         typedef i_slot_base abstract_type;
     public:
         virtual void remove() = 0;
+        virtual bool connected() const = 0;
+    public:
+        // sequence numbers used by async_event_queue to discard all but the latest queued
+        // call to a slot that does not accept duplicates
+        virtual std::uint64_t enqueue_sequence() const = 0;
+        virtual std::uint64_t next_enqueue_sequence() = 0;
+        // makes the calls accumulated by a coalescing or batching slot
+        virtual void deliver() = 0;
+    };
+
+    enum class slot_delivery
+    {
+        Queued,     // each asynchronous call is queued separately
+        Coalesced,  // a pending asynchronous call is replaced by a later one
+        Batched     // pending asynchronous calls are delivered together in one call
     };
 
     template <typename... Args>
@@ -91,10 +123,16 @@ namespace neolib
         virtual i_event<Args...> const& event() const = 0;
         virtual void call(Args... aArgs) const = 0;
         virtual std::thread::id call_thread() const = 0;
+        virtual async_event_queue_handle& call_queue() const = 0;
         virtual bool call_in_emitter_thread() const = 0;
         virtual void set_call_in_emitter_thread(bool aCallInEmitterThread) = 0;
         virtual bool stateless() const = 0;
         virtual void set_stateless(bool aStateless) = 0;
+        virtual slot_delivery delivery() const = 0;
+        virtual void set_delivery(slot_delivery aDelivery) = 0;
+        // stores the arguments of an asynchronous call to a coalescing or batching slot; returns
+        // true if there were no calls pending in which case a delivery must be queued
+        virtual bool accumulate(Args... aArgs) = 0;
     };
 
     enum class trigger_type
@@ -128,6 +166,11 @@ namespace neolib
     template <typename... Args>
     class slot;
 
+    // Calls held for coalesced or batched delivery outlive the trigger so they keep copies of their
+    // arguments; an argument that can't be copied (e.g. a reference to an interface) is kept as is.
+    template <typename Arg>
+    using deferred_argument_t = std::conditional_t<std::is_copy_constructible_v<std::decay_t<Arg>>, std::decay_t<Arg>, Arg>;
+
     template <typename... Args>
     struct slot_proxy
     {
@@ -144,6 +187,12 @@ namespace neolib
             slot->set_stateless(true);
             return std::move(*this);
         }
+
+        slot_proxy&& coalesce()
+        {
+            slot->set_delivery(slot_delivery::Coalesced);
+            return std::move(*this);
+        }
     };
 
     template <typename... Args>
@@ -189,6 +238,10 @@ namespace neolib
         {
             return slot_proxy<Args...>{ make_ref<slot<Args...>>(*this, aCallback) };
         }
+        slot_proxy<Args...> batched(std::function<void(std::span<std::tuple<deferred_argument_t<Args>...> const>)> const& aCallback) const
+        {
+            return slot_proxy<Args...>{ make_ref<slot<Args...>>(*this, aCallback) };
+        }
     };
 
     template <typename... Args>
@@ -196,11 +249,34 @@ namespace neolib
     {
         typedef slot<Args...> self_type;
     public:
-        slot(i_event<Args...> const& aEvent, std::function<void(Args...)> const& aCallable) :
+        typedef std::tuple<deferred_argument_t<Args>...> call_arguments;
+        typedef std::function<void(std::span<call_arguments const>)> batch_callable;
+    public:
+        struct delivery_mismatch : std::logic_error { delivery_mismatch() : std::logic_error("neolib::slot::delivery_mismatch") {} };
+    private:
+        struct pending_calls
+        {
+            spinlock lock;
+            std::vector<call_arguments> calls;
+        };
+    public:
+        slot(i_event<Args...> const& aEvent, std::function<void(Args...)> const& aCallable, bool aCallInEmitterThread = false) :
             iEvent{ aEvent },
             iEventDestroyed{ aEvent },
             iCallable{ aCallable },
-            iCallThread{ std::this_thread::get_id() }
+            iCallThread{ aCallInEmitterThread ? std::nullopt : std::optional<std::thread::id>{ std::this_thread::get_id() } },
+            iCallQueue{ aCallInEmitterThread ? nullptr : this_thread_event_queue() }
+        {
+            event().add_slot(*this);
+        }
+        slot(i_event<Args...> const& aEvent, batch_callable const& aCallable, bool aCallInEmitterThread = false) :
+            iEvent{ aEvent },
+            iEventDestroyed{ aEvent },
+            iBatchCallable{ aCallable },
+            iCallThread{ aCallInEmitterThread ? std::nullopt : std::optional<std::thread::id>{ std::this_thread::get_id() } },
+            iCallQueue{ aCallInEmitterThread ? nullptr : this_thread_event_queue() },
+            iDelivery{ slot_delivery::Batched },
+            iPending{ std::make_unique<pending_calls>() }
         {
             event().add_slot(*this);
         }
@@ -211,16 +287,35 @@ namespace neolib
     public:
         void remove() final
         {
+            iRemoved.store(true, std::memory_order_release);
             if (!iEventDestroyed)
                 event().remove_slot(*this);
         }
+        bool connected() const final
+        {
+            return !iRemoved.load(std::memory_order_acquire) && !iEventDestroyed;
+        }
+        std::uint64_t enqueue_sequence() const final
+        {
+            return iEnqueueSequence.load(std::memory_order_acquire);
+        }
+        std::uint64_t next_enqueue_sequence() final
+        {
+            return iEnqueueSequence.fetch_add(1u, std::memory_order_acq_rel) + 1u;
+        }
         i_event<Args...> const& event() const final
         {
             return iEvent;
         }
         void call(Args... aArgs) const final
         {
-            iCallable(aArgs...);
+            if (iDelivery != slot_delivery::Batched)
+                iCallable(aArgs...);
+            else
+            {
+                call_arguments const arguments{ aArgs... };
+                iBatchCallable(std::span<call_arguments const>{ &arguments, 1u });
+            }
         }
         std::thread::id call_thread() const final
         {
@@ -228,6 +323,12 @@ namespace neolib
                 return std::this_thread::get_id();
             return *iCallThread;
         }
+        async_event_queue_handle& call_queue() const final
+        {
+            if (call_in_emitter_thread() || iCallQueue == nullptr)
+                return *this_thread_event_queue();
+            return *iCallQueue;
+        }
         bool call_in_emitter_thread() const final
         {
             return iCallThread == std::nullopt;
@@ -237,7 +338,10 @@ namespace neolib
             if (aCallInEmitterThread)
                 iCallThread = std::nullopt;
             else
+            {
                 iCallThread = std::this_thread::get_id();
+                iCallQueue = this_thread_event_queue();
+            }
         }
         bool stateless() const final
         {
@@ -247,12 +351,54 @@ namespace neolib
         {
             iStateless = aStateless;
         }
+        slot_delivery delivery() const final
+        {
+            return iDelivery;
+        }
+        void set_delivery(slot_delivery aDelivery) final
+        {
+            if ((aDelivery == slot_delivery::Batched) != (iDelivery == slot_delivery::Batched))
+                throw delivery_mismatch();
+            if (aDelivery != slot_delivery::Queued && iPending == nullptr)
+                iPending = std::make_unique<pending_calls>();
+            iDelivery = aDelivery;
+        }
+        bool accumulate(Args... aArgs) final
+        {
+            std::scoped_lock lock{ iPending->lock };
+            bool const first = iPending->calls.empty();
+            // clear rather than assign as arguments that can't be copied are held by reference
+            if (iDelivery == slot_delivery::Coalesced)
+                iPending->calls.clear();
+            iPending->calls.emplace_back(aArgs...);
+            return first;
+        }
+        void deliver() final
+        {
+            std::vector<call_arguments> calls;
+            {
+                std::scoped_lock lock{ iPending->lock };
+                calls.swap(iPending->calls);
+            }
+            if (calls.empty())
+                return;
+            if (iDelivery == slot_delivery::Batched)
+                iBatchCallable(std::span<call_arguments const>{ calls });
+            else
+                std::apply([&](auto&... aArgs) { iCallable(static_cast<Args>(aArgs)...); }, calls.back());
+        }
     private:
         i_event<Args...> const& iEvent;
         destroyed_flag iEventDestroyed;
         std::function<void(Args...)> iCallable;
+        batch_callable iBatchCallable;
         std::optional<std::thread::id> iCallThread;
+        std::shared_ptr<async_event_queue_handle> iCallQueue;
         bool iStateless = false;
+        slot_delivery iDelivery = slot_delivery::Queued;
+        std::unique_ptr<pending_calls> iPending;
+        std::atomic<bool> iRemoved = false;
+        std::atomic<std::uint64_t> iEnqueueSequence = 0u;
     };
 
     class sink
@@ -279,26 +425,36 @@ namespace neolib
         template <typename... Args>
         slot_proxy<Args...>&& operator=(slot_proxy<Args...>&& aSlot)
         {
-            std::scoped_lock lock{ event_mutex() };
-            clear();
-            iSlots.push_back(aSlot.slot);
+            std::vector<ref_ptr<i_slot_base>> existing;
+            {
+                std::scoped_lock lock{ iLock };
+                existing.swap(iSlots);
+                iSlots.push_back(aSlot.slot);
+            }
+            for (auto& slot : existing)
+                slot->remove();
             return std::move(aSlot);
         }
         template <typename... Args>
         slot_proxy<Args...>&& operator+=(slot_proxy<Args...>&& aSlot)
         {
-            std::scoped_lock lock{ event_mutex() };
+            std::scoped_lock lock{ iLock };
             iSlots.push_back(aSlot.slot);
             return std::move(aSlot);
         }
         void clear()
         {
-            std::scoped_lock lock{ event_mutex() };
-            for (auto& slot : iSlots)
+            std::vector<ref_ptr<i_slot_base>> existing;
+            {
+                std::scoped_lock lock{ iLock };
+                existing.swap(iSlots);
+            }
+            // slots are removed outside the lock as removal may destroy objects owning sinks
+            for (auto& slot : existing)
                 slot->remove();
-            iSlots.clear();
         }
     private:
+        spinlock iLock;
         std::vector<ref_ptr<i_slot_base>> iSlots;
     };
 
@@ -36,6 +36,7 @@
 #pragma once
 
 #include <neolib/neolib.hpp>
+#include <neolib/task/waitable.hpp>
 
 namespace neolib
 {
@@ -49,5 +50,13 @@ namespace neolib
         virtual void bump() = 0;
 		virtual bool in_idle() const = 0;
         virtual void idle() = 0;
+        // returns false if posted messages cannot notify waiters (a native queue) in which case the queue is polled
+        virtual bool add_waiter(waiter&) const
+        {
+            return false;
+        }
+        virtual void remove_waiter(waiter&) const
+        {
+        }
     };
 }
@@ -43,7 +43,8 @@ namespace neolib
     {
         NoYield,
         Yield,
-        Sleep
+        Sleep,
+        Wait // block until woken by new work or a timer deadline (see i_async_task::wake())
     };
 
     enum class thread_state
@@ -36,6 +36,8 @@
 #pragma once
 
 #include <neolib/neolib.hpp>
+#include <chrono>
+#include <optional>
 #if !defined(NDEBUG) || defined(DEBUG_TIMER_OBJECTS)
 #include <iostream>
 #endif
@@ -129,6 +131,10 @@ namespace neolib
         virtual void async_wait(i_timer_subscriber& aSubscriber) = 0;
         virtual void unsubscribe(i_timer_subscriber& aSubscriber) = 0;
         virtual void cancel() = 0;
+        virtual std::optional<std::chrono::steady_clock::time_point> expiry_time() const = 0;
+        // how late the timer may fire so that its expiry can be batched with those of other timers
+        virtual std::chrono::steady_clock::duration slack() const = 0;
+        virtual void set_slack(const std::chrono::steady_clock::duration& aSlack) = 0;
     public:
         virtual bool poll() = 0;
     public:
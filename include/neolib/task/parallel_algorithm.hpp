@@ -0,0 +1,288 @@
+// parallel_algorithm.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <vector>
+#include <neolib/task/thread_pool.hpp>
+
+namespace neolib
+{
+    // Data parallel algorithms. A range is divided into chunks of aGrainSize elements (zero selects a
+    // grain giving a few chunks per pool thread) which are distributed by recursive binary splitting:
+    // each split hands its upper half to the pool and carries on with the lower half so idle threads
+    // steal large blocks of work first. Works with any iterator supporting std::next/std::distance;
+    // random access iterators (and hive's iterators) make splitting cheap.
+
+    namespace detail
+    {
+        template <typename T>
+        concept parallel_range = requires(T& aRange) { std::begin(aRange); std::end(aRange); };
+
+        inline std::size_t parallel_grain_size(thread_pool& aThreadPool, std::size_t aCount, std::size_t aGrainSize)
+        {
+            if (aGrainSize != 0)
+                return aGrainSize;
+            std::size_t const chunksPerThread = 4;
+            return std::max<std::size_t>(1, aCount / (std::max<std::size_t>(1, aThreadPool.max_threads()) * chunksPerThread));
+        }
+
+        template <typename Body>
+        struct parallel_chunk_context
+        {
+            task_group& group;
+            std::size_t count;
+            std::size_t grainSize;
+            Body const& body;
+        };
+
+        template <typename Body, typename... Iters>
+        void parallel_split(parallel_chunk_context<Body> const& aContext, std::size_t aChunkBegin, std::size_t aChunkEnd, Iters... aIters)
+        {
+            while (aChunkEnd - aChunkBegin > 1)
+            {
+                auto const midChunk = aChunkBegin + (aChunkEnd - aChunkBegin) / 2;
+                auto const offset = static_cast<std::ptrdiff_t>((midChunk - aChunkBegin) * aContext.grainSize);
+                aContext.group.run([&aContext, midChunk, aChunkEnd, ... mids = std::next(aIters, offset)]()
+                {
+                    parallel_split(aContext, midChunk, aChunkEnd, mids...);
+                });
+                aChunkEnd = midChunk;
+            }
+            aContext.body(aChunkBegin, std::min(aContext.grainSize, aContext.count - aChunkBegin * aContext.grainSize), aIters...);
+        }
+
+        // Calls aBody(chunkIndex, chunkSize, iters...) for each chunk of aCount elements, each of aIters
+        // having been advanced to the start of the chunk; returns once all chunks have been processed.
+        template <typename Body, typename... Iters>
+        void parallel_chunks(thread_pool& aThreadPool, std::size_t aCount, std::size_t aGrainSize, Body const& aBody, Iters... aIters)
+        {
+            if (aCount == 0)
+                return;
+            auto const grainSize = parallel_grain_size(aThreadPool, aCount, aGrainSize);
+            auto const chunks = (aCount + grainSize - 1) / grainSize;
+            if (chunks == 1 || aThreadPool.stopped() || aThreadPool.max_threads() == 0)
+            {
+                for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+                {
+                    auto const chunkSize = std::min(grainSize, aCount - chunk * grainSize);
+                    aBody(chunk, chunkSize, aIters...);
+                    ((aIters = std::next(aIters, static_cast<std::ptrdiff_t>(chunkSize))), ...);
+                }
+                return;
+            }
+            task_group group{ aThreadPool };
+            parallel_chunk_context<Body> const context{ group, aCount, grainSize, aBody };
+            parallel_split(context, 0, chunks, aIters...);
+            group.wait();
+        }
+
+        inline std::size_t parallel_chunk_count(thread_pool& aThreadPool, std::size_t aCount, std::size_t aGrainSize)
+        {
+            auto const grainSize = parallel_grain_size(aThreadPool, aCount, aGrainSize);
+            return (aCount + grainSize - 1) / grainSize;
+        }
+
+        template <typename RandomIt, typename Compare>
+        void parallel_merge_sort(thread_pool& aThreadPool, RandomIt aFirst, RandomIt aLast, Compare const& aCompare, std::size_t aGrainSize)
+        {
+            if (static_cast<std::size_t>(aLast - aFirst) <= aGrainSize)
+            {
+                std::sort(aFirst, aLast, aCompare);
+                return;
+            }
+            auto const mid = aFirst + (aLast - aFirst) / 2;
+            {
+                task_group group{ aThreadPool };
+                group.run([&]() { parallel_merge_sort(aThreadPool, mid, aLast, aCompare, aGrainSize); });
+                parallel_merge_sort(aThreadPool, aFirst, mid, aCompare, aGrainSize);
+                group.wait();
+            }
+            std::inplace_merge(aFirst, mid, aLast, aCompare);
+        }
+    }
+
+    template <typename ForwardIt, typename Function>
+    inline void parallel_for(thread_pool& aThreadPool, ForwardIt aFirst, ForwardIt aLast, Function aFunction, std::size_t aGrainSize = 0)
+    {
+        detail::parallel_chunks(aThreadPool, static_cast<std::size_t>(std::distance(aFirst, aLast)), aGrainSize,
+            [&](std::size_t, std::size_t aChunkSize, ForwardIt aChunk)
+            {
+                for (; aChunkSize != 0; --aChunkSize, ++aChunk)
+                    aFunction(*aChunk);
+            }, aFirst);
+    }
+
+    template <detail::parallel_range Range, typename Function>
+    inline void parallel_for(thread_pool& aThreadPool, Range& aRange, Function aFunction, std::size_t aGrainSize = 0)
+    {
+        parallel_for(aThreadPool, std::begin(aRange), std::end(aRange), std::move(aFunction), aGrainSize);
+    }
+
+    template <typename ForwardIt1, typename ForwardIt2, typename UnaryOperation>
+    inline ForwardIt2 parallel_transform(thread_pool& aThreadPool, ForwardIt1 aFirst, ForwardIt1 aLast, ForwardIt2 aDestination, UnaryOperation aOperation, std::size_t aGrainSize = 0)
+    {
+        auto const count = std::distance(aFirst, aLast);
+        detail::parallel_chunks(aThreadPool, static_cast<std::size_t>(count), aGrainSize,
+            [&](std::size_t, std::size_t aChunkSize, ForwardIt1 aChunk, ForwardIt2 aChunkDestination)
+            {
+                for (; aChunkSize != 0; --aChunkSize, ++aChunk, ++aChunkDestination)
+                    *aChunkDestination = aOperation(*aChunk);
+            }, aFirst, aDestination);
+        return std::next(aDestination, count);
+    }
+
+    template <detail::parallel_range Range, typename ForwardIt, typename UnaryOperation>
+    inline ForwardIt parallel_transform(thread_pool& aThreadPool, Range const& aRange, ForwardIt aDestination, UnaryOperation aOperation, std::size_t aGrainSize = 0)
+    {
+        return parallel_transform(aThreadPool, std::begin(aRange), std::end(aRange), aDestination, std::move(aOperation), aGrainSize);
+    }
+
+    // aOperation must be associative; partial results are combined in range order so it need not be commutative.
+    template <typename ForwardIt, typename T, typename BinaryOperation = std::plus<>>
+    inline T parallel_reduce(thread_pool& aThreadPool, ForwardIt aFirst, ForwardIt aLast, T aInitial, BinaryOperation aOperation = {}, std::size_t aGrainSize = 0)
+    {
+        auto const count = static_cast<std::size_t>(std::distance(aFirst, aLast));
+        std::vector<std::optional<T>> partials(detail::parallel_chunk_count(aThreadPool, count, aGrainSize));
+        detail::parallel_chunks(aThreadPool, count, aGrainSize,
+            [&](std::size_t aChunkIndex, std::size_t aChunkSize, ForwardIt aChunk)
+            {
+                T partial = *aChunk;
+                for (++aChunk, --aChunkSize; aChunkSize != 0; --aChunkSize, ++aChunk)
+                    partial = aOperation(std::move(partial), *aChunk);
+                partials[aChunkIndex].emplace(std::move(partial));
+            }, aFirst);
+        for (auto& partial : partials)
+            aInitial = aOperation(std::move(aInitial), std::move(*partial));
+        return aInitial;
+    }
+
+    template <detail::parallel_range Range, typename T, typename BinaryOperation = std::plus<>>
+    inline T parallel_reduce(thread_pool& aThreadPool, Range const& aRange, T aInitial, BinaryOperation aOperation = {}, std::size_t aGrainSize = 0)
+    {
+        return parallel_reduce(aThreadPool, std::begin(aRange), std::end(aRange), std::move(aInitial), std::move(aOperation), aGrainSize);
+    }
+
+    // Two pass scan: chunk totals are reduced in parallel, prefixed serially and then each chunk is
+    // scanned in parallel from its carry-in. aDestination may equal aFirst.
+    template <typename ForwardIt1, typename ForwardIt2, typename BinaryOperation = std::plus<>>
+    inline ForwardIt2 parallel_inclusive_scan(thread_pool& aThreadPool, ForwardIt1 aFirst, ForwardIt1 aLast, ForwardIt2 aDestination, BinaryOperation aOperation = {}, std::size_t aGrainSize = 0)
+    {
+        typedef typename std::iterator_traits<ForwardIt1>::value_type value_type;
+        auto const count = static_cast<std::size_t>(std::distance(aFirst, aLast));
+        std::vector<std::optional<value_type>> carries(detail::parallel_chunk_count(aThreadPool, count, aGrainSize));
+        detail::parallel_chunks(aThreadPool, count, aGrainSize,
+            [&](std::size_t aChunkIndex, std::size_t aChunkSize, ForwardIt1 aChunk)
+            {
+                if (aChunkIndex + 1 == carries.size())
+                    return; // the final chunk's total isn't needed
+                value_type total = *aChunk;
+                for (++aChunk, --aChunkSize; aChunkSize != 0; --aChunkSize, ++aChunk)
+                    total = aOperation(std::move(total), *aChunk);
+                carries[aChunkIndex + 1].emplace(std::move(total));
+            }, aFirst);
+        for (std::size_t chunk = 2; chunk < carries.size(); ++chunk)
+            *carries[chunk] = aOperation(*carries[chunk - 1], std::move(*carries[chunk]));
+        detail::parallel_chunks(aThreadPool, count, aGrainSize,
+            [&](std::size_t aChunkIndex, std::size_t aChunkSize, ForwardIt1 aChunk, ForwardIt2 aChunkDestination)
+            {
+                value_type running = carries[aChunkIndex] ? aOperation(*carries[aChunkIndex], *aChunk) : value_type{ *aChunk };
+                for (;;)
+                {
+                    *aChunkDestination = running;
+                    if (--aChunkSize == 0)
+                        break;
+                    ++aChunk;
+                    ++aChunkDestination;
+                    running = aOperation(std::move(running), *aChunk);
+                }
+            }, aFirst, aDestination);
+        return std::next(aDestination, static_cast<std::ptrdiff_t>(count));
+    }
+
+    template <detail::parallel_range Range, typename ForwardIt, typename BinaryOperation = std::plus<>>
+    inline ForwardIt parallel_inclusive_scan(thread_pool& aThreadPool, Range const& aRange, ForwardIt aDestination, BinaryOperation aOperation = {}, std::size_t aGrainSize = 0)
+    {
+        return parallel_inclusive_scan(aThreadPool, std::begin(aRange), std::end(aRange), aDestination, std::move(aOperation), aGrainSize);
+    }
+
+    // Parallel merge sort: halves are sorted concurrently down to the grain size and then merged.
+    // Ranges without random access iterators (e.g. hive) are sorted via a temporary vector.
+    template <typename ForwardIt, typename Compare = std::less<>>
+    inline void parallel_sort(thread_pool& aThreadPool, ForwardIt aFirst, ForwardIt aLast, Compare aCompare = {}, std::size_t aGrainSize = 0)
+    {
+        if constexpr (std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<ForwardIt>::iterator_category>)
+        {
+            auto const count = static_cast<std::size_t>(aLast - aFirst);
+            auto const grainSize = std::max<std::size_t>(detail::parallel_grain_size(aThreadPool, count, aGrainSize), 2);
+            if (aThreadPool.stopped() || aThreadPool.max_threads() == 0)
+                std::sort(aFirst, aLast, aCompare);
+            else
+                detail::parallel_merge_sort(aThreadPool, aFirst, aLast, aCompare, grainSize);
+        }
+        else
+        {
+            std::vector<typename std::iterator_traits<ForwardIt>::value_type> temp{ std::make_move_iterator(aFirst), std::make_move_iterator(aLast) };
+            parallel_sort(aThreadPool, temp.begin(), temp.end(), std::move(aCompare), aGrainSize);
+            std::move(temp.begin(), temp.end(), aFirst);
+        }
+    }
+
+    template <detail::parallel_range Range, typename Compare = std::less<>>
+    inline void parallel_sort(thread_pool& aThreadPool, Range& aRange, Compare aCompare = {}, std::size_t aGrainSize = 0)
+    {
+        parallel_sort(aThreadPool, std::begin(aRange), std::end(aRange), std::move(aCompare), aGrainSize);
+    }
+
+    template <typename Container>
+    inline void parallel_apply(thread_pool& aThreadPool, Container& aContainer, std::function<void(typename Container::value_type& aElement)> aFunction, std::size_t aMinimumParallelismCount = 0)
+    {
+        if (aThreadPool.stopped())
+            return;
+        if (aContainer.size() < aMinimumParallelismCount)
+        {
+            for (auto& e : aContainer)
+                aFunction(e);
+            return;
+        }
+        parallel_for(aThreadPool, aContainer, aFunction);
+    }
+}
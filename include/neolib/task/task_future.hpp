@@ -0,0 +1,363 @@
+// task_future.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include <neolib/task/thread_pool.hpp>
+
+namespace neolib
+{
+    template <typename T>
+    class task_future;
+
+    namespace detail
+    {
+        template <typename T>
+        using task_result_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+        // Shared state of a task_future; continuations registered before completion are posted to the
+        // pool when the result is set, those registered afterwards are posted immediately.
+        template <typename T>
+        class task_future_state
+        {
+        public:
+            typedef task_result_t<T> result_type;
+        private:
+            typedef std::pair<std::function<void()>, int32_t> continuation;
+        public:
+            explicit task_future_state(thread_pool& aThreadPool) :
+                iThreadPool{ aThreadPool }, iReady{ false }
+            {
+            }
+        public:
+            thread_pool& pool() const
+            {
+                return iThreadPool;
+            }
+            bool ready() const
+            {
+                return iReady.load(std::memory_order_acquire);
+            }
+            void wait() const
+            {
+                // help the pool rather than tie up a thread while waiting
+                while (!ready())
+                {
+                    if (iThreadPool.try_run_one())
+                        continue;
+                    std::unique_lock<std::mutex> lk{ iMutex };
+                    iConditionVariable.wait_for(lk, std::chrono::milliseconds{ 1 }, [this]() { return ready(); });
+                }
+            }
+            result_type const& value() const
+            {
+                wait();
+                if (iException)
+                    std::rethrow_exception(iException);
+                return *iResult;
+            }
+            std::exception_ptr exception() const
+            {
+                wait();
+                return iException;
+            }
+            void set_value(result_type aResult)
+            {
+                complete([&]() { iResult.emplace(std::move(aResult)); });
+            }
+            void set_exception(std::exception_ptr aException)
+            {
+                complete([&]() { iException = aException; });
+            }
+            template <typename Function>
+            void fulfil(Function&& aFunction)
+            {
+                try
+                {
+                    if constexpr (std::is_void_v<T>)
+                    {
+                        aFunction();
+                        set_value({});
+                    }
+                    else
+                        set_value(aFunction());
+                }
+                catch (...)
+                {
+                    set_exception(std::current_exception());
+                }
+            }
+            void on_ready(std::function<void()> aContinuation, int32_t aPriority)
+            {
+                {
+                    std::scoped_lock<std::mutex> lk{ iMutex };
+                    if (!ready())
+                    {
+                        iContinuations.emplace_back(std::move(aContinuation), aPriority);
+                        return;
+                    }
+                }
+                dispatch(std::move(aContinuation), aPriority);
+            }
+        private:
+            template <typename Setter>
+            void complete(Setter&& aSetter)
+            {
+                std::vector<continuation> continuations;
+                {
+                    std::scoped_lock<std::mutex> lk{ iMutex };
+                    aSetter();
+                    iReady.store(true, std::memory_order_release);
+                    std::swap(continuations, iContinuations);
+                }
+                iConditionVariable.notify_all();
+                for (auto& c : continuations)
+                    dispatch(std::move(c.first), c.second);
+            }
+            void dispatch(std::function<void()> aContinuation, int32_t aPriority)
+            {
+                if (!iThreadPool.post(std::move(aContinuation), aPriority))
+                    aContinuation(); // pool stopped so post() didn't take the continuation; run it inline
+            }
+        private:
+            thread_pool& iThreadPool;
+            mutable std::mutex iMutex;
+            mutable std::condition_variable iConditionVariable;
+            std::atomic<bool> iReady;
+            std::optional<result_type> iResult;
+            std::exception_ptr iException;
+            std::vector<continuation> iContinuations;
+        };
+    }
+
+    // The eventual result of a task run on a thread_pool. Unlike std::future, further work can be
+    // chained onto it with then() (and combined with when_all()/when_any()) without a thread blocking
+    // on the result; waiting, if needed, helps the pool execute queued work.
+    template <typename T>
+    class task_future
+    {
+        template <typename>
+        friend class task_future;
+        // types
+    public:
+        typedef T value_type;
+        typedef detail::task_future_state<T> state_type;
+        // exceptions
+    public:
+        struct no_state : std::logic_error { no_state() : std::logic_error{ "neolib::task_future::no_state" } {} };
+        // construction
+    public:
+        task_future() = default;
+        explicit task_future(std::shared_ptr<state_type> aState) :
+            iState{ std::move(aState) }
+        {
+        }
+        // operations
+    public:
+        bool valid() const
+        {
+            return iState != nullptr;
+        }
+        bool ready() const
+        {
+            return state().ready();
+        }
+        void wait() const
+        {
+            state().wait();
+        }
+        decltype(auto) get() const
+        {
+            if constexpr (std::is_void_v<T>)
+                state().value();
+            else
+                return state().value();
+        }
+        thread_pool& pool() const
+        {
+            return state().pool();
+        }
+        // aFunction is passed the result (nothing if T is void) and only called if this task succeeded,
+        // otherwise the returned future holds this task's exception.
+        template <typename Function>
+        auto then(Function&& aFunction, int32_t aPriority = 0) const
+        {
+            typedef typename std::conditional_t<std::is_void_v<T>, std::invoke_result<Function>, std::invoke_result<Function, T const&>>::type result_type;
+            auto next = std::make_shared<detail::task_future_state<result_type>>(pool());
+            state().on_ready([antecedent = iState, next, function = std::forward<Function>(aFunction)]() mutable
+            {
+                if (auto const exception = antecedent->exception())
+                    next->set_exception(exception);
+                else if constexpr (std::is_void_v<T>)
+                    next->fulfil(function);
+                else
+                    next->fulfil([&]() { return function(antecedent->value()); });
+            }, aPriority);
+            return task_future<result_type>{ next };
+        }
+        // implementation
+    public:
+        state_type& state() const
+        {
+            if (!iState)
+                throw no_state();
+            return *iState;
+        }
+        // attributes
+    private:
+        std::shared_ptr<state_type> iState;
+    };
+
+    template <typename Function>
+    inline auto launch(thread_pool& aThreadPool, Function&& aFunction, int32_t aPriority = 0)
+    {
+        typedef std::invoke_result_t<Function> result_type;
+        auto state = std::make_shared<detail::task_future_state<result_type>>(aThreadPool);
+        auto work = [state, function = std::forward<Function>(aFunction)]() mutable
+        {
+            state->fulfil(function);
+        };
+        if (!aThreadPool.post(std::move(work), aPriority))
+            work(); // pool stopped so post() didn't take the work; run it inline
+        return task_future<result_type>{ state };
+    }
+
+    // Completes when every future has completed; holds the results in order, or the first exception.
+    template <typename T>
+    inline auto when_all(std::vector<task_future<T>> aFutures)
+    {
+        typedef std::conditional_t<std::is_void_v<T>, void, std::vector<T>> result_type;
+        auto& pool = aFutures.empty() ? thread_pool::default_thread_pool() : aFutures[0].pool();
+        auto result = std::make_shared<detail::task_future_state<result_type>>(pool);
+        if (aFutures.empty())
+        {
+            result->set_value({});
+            return task_future<result_type>{ result };
+        }
+        // one shared copy of the futures for all of the continuations rather than a copy each
+        auto const futures = std::make_shared<const std::vector<task_future<T>>>(std::move(aFutures));
+        auto remaining = std::make_shared<std::atomic<std::size_t>>(futures->size());
+        for (auto const& f : *futures)
+            f.state().on_ready([result, remaining, futures]()
+            {
+                if (--*remaining != 0)
+                    return;
+                result->fulfil([&]()
+                {
+                    if constexpr (std::is_void_v<T>)
+                    {
+                        for (auto const& f : *futures)
+                            f.get();
+                    }
+                    else
+                    {
+                        std::vector<T> values;
+                        values.reserve(futures->size());
+                        for (auto const& f : *futures)
+                            values.push_back(f.get());
+                        return values;
+                    }
+                });
+            }, 0);
+        return task_future<result_type>{ result };
+    }
+
+    template <typename... T>
+    inline auto when_all(task_future<T> const&... aFutures)
+    {
+        typedef std::tuple<detail::task_result_t<T>...> result_type;
+        static_assert(sizeof...(T) > 0, "neolib::when_all: no futures");
+        auto& pool = std::get<0>(std::forward_as_tuple(aFutures...)).pool();
+        auto result = std::make_shared<detail::task_future_state<result_type>>(pool);
+        auto remaining = std::make_shared<std::atomic<std::size_t>>(sizeof...(T));
+        auto const futures = std::make_tuple(aFutures...);
+        auto const onReady = [result, remaining, futures]()
+        {
+            if (--*remaining != 0)
+                return;
+            result->fulfil([&]()
+            {
+                return std::apply([](auto const&... aFuture) { return result_type{ aFuture.state().value()... }; }, futures);
+            });
+        };
+        (aFutures.state().on_ready(onReady, 0), ...);
+        return task_future<result_type>{ result };
+    }
+
+    // Completes when the first of the futures completes (successfully or not) with that future's index.
+    template <typename T>
+    inline task_future<std::size_t> when_any(std::vector<task_future<T>> const& aFutures)
+    {
+        auto& pool = aFutures.empty() ? thread_pool::default_thread_pool() : aFutures[0].pool();
+        auto result = std::make_shared<detail::task_future_state<std::size_t>>(pool);
+        auto claimed = std::make_shared<std::atomic<bool>>(false);
+        for (std::size_t index = 0; index < aFutures.size(); ++index)
+            aFutures[index].state().on_ready([result, claimed, index]()
+            {
+                if (!claimed->exchange(true))
+                    result->set_value(index);
+            }, 0);
+        return task_future<std::size_t>{ result };
+    }
+
+    template <typename... T>
+    inline task_future<std::size_t> when_any(task_future<T> const&... aFutures)
+    {
+        static_assert(sizeof...(T) > 0, "neolib::when_any: no futures");
+        auto& pool = std::get<0>(std::forward_as_tuple(aFutures...)).pool();
+        auto result = std::make_shared<detail::task_future_state<std::size_t>>(pool);
+        auto claimed = std::make_shared<std::atomic<bool>>(false);
+        std::size_t index = 0;
+        (aFutures.state().on_ready([result, claimed, index = index++]()
+        {
+            if (!claimed->exchange(true))
+                result->set_value(index);
+        }, 0), ...);
+        return task_future<std::size_t>{ result };
+    }
+}
@@ -0,0 +1,100 @@
+// task_graph.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <neolib/core/noncopyable.hpp>
+#include <neolib/task/thread_pool.hpp>
+
+namespace neolib
+{
+    // A directed acyclic graph of work items executed on a thread_pool with maximal parallelism: a node
+    // is submitted as soon as all of its predecessors have completed. The graph is built once and can
+    // then be run repeatedly (e.g. once per frame) without allocating.
+    class NEOLIB_EXPORT task_graph : private noncopyable
+    {
+        // types
+    public:
+        typedef std::size_t node_id;
+    private:
+        struct node
+        {
+            std::function<void()> work;
+            int32_t priority;
+            std::vector<node_id> successors;
+            std::size_t predecessors;
+            std::atomic<std::size_t> pending;
+        };
+        // exceptions
+    public:
+        struct node_not_found : std::logic_error { node_not_found() : std::logic_error{ "neolib::task_graph::node_not_found" } {} };
+        struct cycle_detected : std::logic_error { cycle_detected() : std::logic_error{ "neolib::task_graph::cycle_detected" } {} };
+        struct graph_running : std::logic_error { graph_running() : std::logic_error{ "neolib::task_graph::graph_running" } {} };
+        // construction
+    public:
+        task_graph(thread_pool& aThreadPool = thread_pool::default_thread_pool());
+        ~task_graph();
+        // operations
+    public:
+        thread_pool& pool() const;
+        std::size_t node_count() const;
+        node_id add_node(std::function<void()> aWork, int32_t aPriority = 0);
+        // aTo will not start until aFrom has completed
+        void add_edge(node_id aFrom, node_id aTo);
+        void clear();
+        // runs every node and waits (helping the pool) for the graph to complete; if a node throws then
+        // nodes not yet started are skipped and the first exception is rethrown
+        void run();
+        bool running() const;
+        // implementation
+    private:
+        void validate();
+        void execute(node_id aNode);
+        // attributes
+    private:
+        thread_pool& iThreadPool;
+        std::deque<node> iNodes;
+        std::vector<node_id> iRoots;
+        bool iValidated;
+        std::atomic<bool> iRunning;
+        std::atomic<bool> iFailed;
+        task_group iGroup;
+    };
+}
@@ -46,6 +46,7 @@
 #include <neolib/task/waitable.hpp>
 #include <neolib/task/waitable_event.hpp>
 #include <neolib/task/i_thread.hpp>
+#include <neolib/task/thread_placement.hpp>
 
 namespace neolib
 {
@@ -58,6 +59,9 @@ namespace neolib
         std::uint64_t elapsed_ms() noexcept;
         std::uint64_t elapsed_us() noexcept;
         std::uint64_t elapsed_ns() noexcept;
+        std::optional<cpu_id> current_cpu() noexcept;
+        bool set_affinity(cpu_list const& aCpus);
+        void set_name(std::string const& aName);
 
         inline void relax() noexcept
         {
@@ -119,10 +123,14 @@ namespace neolib
         bool blocked() const noexcept;
         bool has_thread_object() const noexcept;
         thread_object_type& thread_object() const;
+        std::optional<cpu_list> affinity() const;
+        bool set_affinity(cpu_list const& aCpus);
         // implementation
     private:
         // from waitable
         bool waitable_ready() const noexcept override;
+        bool add_waiter(waiter& aWaiter) const override;
+        void remove_waiter(waiter& aWaiter) const override;
         // own
         void exec_preamble() override;
         void exec(yield_type aYieldType = yield_type::NoYield) override;
@@ -137,5 +145,7 @@ namespace neolib
         thread_object_pointer iThreadObject;
         id_type iId;
         std::atomic<std::size_t> iBlockedCount;
+        std::optional<cpu_list> iAffinity;
+        waiter_list iWaiters;
     };
 }
@@ -0,0 +1,83 @@
+// thread_placement.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace neolib
+{
+    typedef std::uint32_t cpu_id;
+    typedef std::vector<cpu_id> cpu_list;
+
+    // CPU topology (logical CPUs and NUMA nodes); a machine without NUMA information is reported as
+    // a single node containing every CPU.
+    std::uint32_t cpu_count();
+    cpu_list all_cpus();
+    std::uint32_t numa_node_count();
+    cpu_list numa_node_cpus(std::uint32_t aNode);
+    std::optional<std::uint32_t> numa_node_of_cpu(cpu_id aCpu);
+
+    // Where a group of threads (e.g. the threads of a thread_pool) may run: restricted to a set of
+    // CPUs (any CPU if empty) and optionally with each thread pinned to a single CPU of the set.
+    struct thread_placement
+    {
+        cpu_list cpus;
+        bool pinned = false;
+
+        static thread_placement any()
+        {
+            return {};
+        }
+        static thread_placement on_cpus(cpu_list const& aCpus, bool aPinned = false)
+        {
+            return { aCpus, aPinned };
+        }
+        static thread_placement on_numa_node(std::uint32_t aNode, bool aPinned = false)
+        {
+            return { numa_node_cpus(aNode), aPinned };
+        }
+        // e.g. keep pool threads off CPUs reserved for system threads
+        thread_placement excluding(cpu_list const& aReservedCpus) const;
+        // affinity for the aThreadIndex-th thread of the group; empty means unrestricted
+        cpu_list affinity(std::size_t aThreadIndex) const;
+
+        friend bool operator==(thread_placement const&, thread_placement const&) = default;
+    };
+}
@@ -36,13 +36,24 @@
 #pragma once
 
 #include <neolib/neolib.hpp>
+#include <cstddef>
+#include <new>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <optional>
 #include <memory>
 #include <vector>
+#include <set>
 #include <deque>
 #include <future>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <exception>
+#include <neolib/core/noncopyable.hpp>
 #include <neolib/task/i_thread.hpp>
+#include <neolib/task/thread_placement.hpp>
 #include <neolib/task/task.hpp>
 
 namespace neolib
@@ -57,8 +68,94 @@ namespace neolib
     public:
         struct no_threads : std::logic_error { no_threads() : std::logic_error("neolib::thread_pool::no_threads") {} };
         struct task_not_found : std::logic_error { task_not_found() : std::logic_error("neolib::thread_pool::task_not_found") {} };
+        struct too_many_priority_levels : std::logic_error { too_many_priority_levels() : std::logic_error("neolib::thread_pool::too_many_priority_levels") {} };
+    public:
+        static constexpr std::size_t kMaxPriorityLevels = 64;
+    public:
+        // Elastic sizing: the pool keeps at least minThreads threads, adds threads (up to maxThreads) while
+        // more than queueDepthPerThread tasks per thread have been waiting for at least growthDelay with
+        // no thread idle, and retires threads that have been idle for idleTimeout.
+        struct elastic_policy
+        {
+            std::size_t minThreads = 1;
+            std::size_t maxThreads = std::thread::hardware_concurrency();
+            std::chrono::steady_clock::duration idleTimeout = std::chrono::seconds{ 10 };
+            std::chrono::steady_clock::duration growthDelay = std::chrono::milliseconds{ 1 };
+            std::size_t queueDepthPerThread = 2;
+        };
+        struct worker_statistics
+        {
+            std::size_t queueDepth = 0;
+            bool active = false;
+            std::uint64_t tasksExecuted = 0;
+            std::uint64_t stealAttempts = 0;
+            std::uint64_t steals = 0;
+        };
+        // A point-in-time view of the pool's counters, taken without pausing the pool so the figures are
+        // only mutually consistent to within the work done while taking it. Latency and run time are
+        // only recorded while timing is enabled (see enable_timing()).
+        struct statistics
+        {
+            // bucket i counts durations of [2^i, 2^(i+1)) nanoseconds; the last bucket also counts anything longer
+            static constexpr std::size_t kHistogramBuckets = 40;
+            typedef std::array<std::uint64_t, kHistogramBuckets> histogram;
+
+            std::vector<worker_statistics> workers;
+            std::size_t injectionQueueDepth = 0;
+            std::size_t scheduledTasks = 0;
+            std::size_t activeThreads = 0;
+            std::size_t parkedThreads = 0;
+            // totals include tasks run by threads that have since retired and by non-pool threads helping out
+            std::uint64_t tasksExecuted = 0;
+            std::uint64_t stealAttempts = 0;
+            std::uint64_t steals = 0;
+            histogram startLatency = {};
+            histogram runTime = {};
+
+            static std::chrono::nanoseconds bucket_limit(std::size_t aBucket)
+            {
+                return std::chrono::nanoseconds{ std::int64_t{ 1 } << (aBucket + 1) };
+            }
+            // upper bound of the bucket containing the given fraction (0.0 to 1.0) of the recorded durations
+            static std::chrono::nanoseconds percentile(histogram const& aHistogram, double aFraction)
+            {
+                std::uint64_t total = 0;
+                for (auto count : aHistogram)
+                    total += count;
+                std::uint64_t seen = 0;
+                for (std::size_t bucket = 0; bucket < kHistogramBuckets; ++bucket)
+                    if (total != 0 && (seen += aHistogram[bucket]) >= aFraction * total)
+                        return bucket_limit(bucket);
+                return std::chrono::nanoseconds::zero();
+            }
+        };
     private:
+        struct worker_counters;
         typedef std::vector<std::unique_ptr<i_thread>> thread_list;
+        struct priority_level;
+        typedef std::vector<std::unique_ptr<priority_level>> priority_levels;
+        class scheduled_task;
+        struct timer_entry
+        {
+            std::chrono::steady_clock::time_point due;
+            std::uint64_t sequence;
+            std::shared_ptr<scheduled_task> task;
+        };
+        typedef std::vector<timer_entry> timer_heap;
+        // queue entries are recycled through a per-thread free list; a posted callable is stored
+        // inline in the entry when it fits, so small fire-and-forget tasks need no heap allocation
+        struct task_queue_entry
+        {
+            static constexpr std::size_t kInlineStorageSize = 64;
+            task_pointer task;
+            int32_t priority;
+            priority_level* level;
+            std::chrono::steady_clock::time_point enqueued;
+            void(*invoke)(task_queue_entry& aEntry);
+            void(*destroy)(task_queue_entry& aEntry);
+            task_queue_entry* next;
+            alignas(std::max_align_t) std::byte storage[kInlineStorageSize];
+        };
     public:
         thread_pool();
         ~thread_pool();
@@ -68,6 +165,10 @@ namespace neolib
         std::size_t available_threads() const;
         std::size_t total_threads() const;
         std::size_t max_threads() const;
+        thread_placement placement() const;
+        void set_placement(thread_placement const& aPlacement);
+        std::optional<elastic_policy> elastic() const;
+        void set_elastic(std::optional<elastic_policy> const& aPolicy);
     public:
         void start(i_task& aTask, int32_t aPriority = 0);
         void start(task_pointer aTask, int32_t aPriority = 0);
@@ -76,6 +177,26 @@ namespace neolib
         std::pair<std::future<void>, task_pointer> run(std::function<void()> aFunction, int32_t aPriority = 0);
         template <typename T>
         std::pair<std::future<T>, task_pointer> run(std::function<T()> aFunction, int32_t aPriority = 0);
+        template <typename Function>
+        bool post(Function&& aFunction, int32_t aPriority = 0);
+    public:
+        task_pointer run_at(std::chrono::steady_clock::time_point aWhen, std::function<void()> aFunction, int32_t aPriority = 0);
+        task_pointer run_after(std::chrono::steady_clock::duration aDelay, std::function<void()> aFunction, int32_t aPriority = 0);
+        task_pointer run_every(std::chrono::steady_clock::duration aPeriod, std::function<void()> aFunction, int32_t aPriority = 0);
+        std::size_t scheduled_tasks() const;
+    public:
+        bool try_run_one();
+    public:
+        void enable_aging(std::chrono::steady_clock::duration aInterval);
+        void disable_aging();
+        bool aging_enabled() const;
+        void set_concurrency_limit(int32_t aPriority, std::optional<std::size_t> const& aLimit);
+        std::optional<std::size_t> concurrency_limit(int32_t aPriority) const;
+    public:
+        statistics snapshot() const;
+        void reset_statistics();
+        void enable_timing(bool aEnable = true);
+        bool timing_enabled() const;
     public:
         bool idle() const;
         void update_idle();
@@ -87,17 +208,92 @@ namespace neolib
         static thread_pool& default_thread_pool();
         std::recursive_mutex& mutex() const;
     private:
-        void steal_work(thread_pool_thread& aIdleThread);
-        void thread_gone_idle();
-        void thread_gone_busy();
+        void add_thread();
+        void grow_if();
+        bool retire(thread_pool_thread& aIdleThread);
+        void reap_retired();
+        void schedule(std::shared_ptr<scheduled_task> aTask, std::chrono::steady_clock::time_point aDue);
+        void service_timers();
+        static task_queue_entry* allocate_entry();
+        static void free_entry(task_queue_entry* aEntry);
+        void submit(task_queue_entry* aEntry);
+        std::size_t level_index(int32_t aPriority, bool aExact = false);
+        void reclaim_levels();
+        task_queue_entry* pop_injected();
+        task_queue_entry* next_task(thread_pool_thread* aThread);
+        task_queue_entry* steal_work(thread_pool_thread* aIdleThread);
+        void execute(task_queue_entry* aEntry, yield_type aYieldType);
+        bool park(thread_pool_thread& aIdleThread, std::size_t aWorkGeneration);
+        void unpark();
+        void task_completed(task_queue_entry* aEntry);
+        worker_counters& counters();
     private:
         mutable std::recursive_mutex iMutex;
-        std::atomic<bool> iIdle;
+        mutable std::shared_mutex iThreadsMutex;
         std::atomic<bool> iStopped;
         std::size_t iMaxThreads;
+        thread_placement iPlacement;
         thread_list iThreads;
+        thread_list iRetiredThreads;
+        std::atomic<std::size_t> iThreadCount;
+        std::size_t iNextThreadIndex;
+        std::set<std::size_t> iFreeThreadIndices;
+        std::size_t iNextThreadSerial;
+        std::optional<elastic_policy> iElasticPolicy;
+        std::atomic<bool> iElastic;
+        std::atomic<bool> iGrowing;
+        std::atomic<std::chrono::steady_clock::rep> iIdleTimeout;
+        std::atomic<std::chrono::steady_clock::rep> iGrowthDelay;
+        std::atomic<std::size_t> iGrowthQueueDepth;
+        std::atomic<std::chrono::steady_clock::rep> iBacklogSince;
+        mutable std::mutex iInjectionMutex;
+        priority_levels iPriorityLevels; // highest priority first
+        std::uint64_t iNonEmptyLevels;
+        std::optional<std::chrono::steady_clock::duration> iAgingInterval;
+        std::atomic<bool> iDefaultPriorityLimited;
+        std::atomic<std::size_t> iInjectionQueueSize;
+        std::atomic<std::size_t> iWorkGeneration;
+        std::atomic<std::size_t> iQueuedTasks;
+        std::atomic<std::size_t> iPendingTasks;
+        std::atomic<std::size_t> iActiveThreads;
+        std::atomic<std::size_t> iParkedThreads;
+        mutable std::mutex iTimerMutex;
+        timer_heap iTimerHeap;
+        std::uint64_t iTimerSequence;
+        std::atomic<std::chrono::steady_clock::rep> iNextDeadline;
+        bool iTimerWaiter;
+        std::mutex iParkMutex;
+        std::condition_variable iParkConditionVariable;
+        std::condition_variable iTimerConditionVariable;
         mutable std::mutex iWaitMutex;
         mutable std::condition_variable iWaitConditionVariable;
+        std::atomic<bool> iTimingEnabled;
+        std::unique_ptr<worker_counters> iSharedCounters; // non-pool threads and retired threads
+    };
+
+    // A batch of tasks that can be waited on independently of any other work running on the pool;
+    // a thread waiting on a group helps execute queued tasks rather than blocking.
+    class NEOLIB_EXPORT task_group : private noncopyable
+    {
+    public:
+        task_group(thread_pool& aThreadPool = thread_pool::default_thread_pool());
+        ~task_group();
+    public:
+        thread_pool& pool() const;
+        template <typename Function>
+        void run(Function&& aFunction, int32_t aPriority = 0);
+        std::size_t outstanding() const;
+        bool done() const;
+        void wait();
+    private:
+        void task_done(std::exception_ptr aException);
+        void wait_no_throw();
+    private:
+        thread_pool& iThreadPool;
+        std::atomic<std::size_t> iOutstanding;
+        std::mutex iMutex;
+        std::condition_variable iConditionVariable;
+        std::exception_ptr iException;
     };
 
     template <typename T>
@@ -110,37 +306,71 @@ namespace neolib
         return std::make_pair(newTask->get_future(), newTask);
     }
 
-    template <typename Container>
-    inline void parallel_apply(thread_pool& aThreadPool, Container& aContainer, std::function<void(typename Container::value_type& aElement)> aFunction, std::size_t aMinimumParallelismCount = 0)
+    // Fire-and-forget submission: no task object, promise or future is created. Returns false (leaving
+    // aFunction unconsumed) if the pool has been stopped.
+    template <typename Function>
+    inline bool thread_pool::post(Function&& aFunction, int32_t aPriority)
     {
-        if (aThreadPool.stopped())
-            return;
-        if (aContainer.size() < aMinimumParallelismCount)
+        typedef std::decay_t<Function> callable_type;
+        if (stopped())
+            return false;
+        if (max_threads() == 0)
+            throw no_threads();
+        auto entry = allocate_entry();
+        entry->priority = aPriority;
+        try
         {
-            for (auto& e : aContainer)
-                aFunction(e);
-            return;
+            if constexpr (sizeof(callable_type) <= task_queue_entry::kInlineStorageSize &&
+                alignof(callable_type) <= alignof(std::max_align_t) &&
+                std::is_nothrow_move_constructible_v<callable_type>)
+            {
+                new (entry->storage) callable_type{ std::forward<Function>(aFunction) };
+                entry->invoke = [](task_queue_entry& aEntry) { (*std::launder(reinterpret_cast<callable_type*>(aEntry.storage)))(); };
+                entry->destroy = [](task_queue_entry& aEntry) { std::launder(reinterpret_cast<callable_type*>(aEntry.storage))->~callable_type(); };
+            }
+            else
+            {
+                new (entry->storage) callable_type*{ new callable_type{ std::forward<Function>(aFunction) } };
+                entry->invoke = [](task_queue_entry& aEntry) { (**std::launder(reinterpret_cast<callable_type**>(aEntry.storage)))(); };
+                entry->destroy = [](task_queue_entry& aEntry) { delete *std::launder(reinterpret_cast<callable_type**>(aEntry.storage)); };
+            }
         }
-        auto subrange = aContainer.size() / aThreadPool.max_threads();
-        if (subrange < 1)
-            subrange = 1;
-        auto next = aContainer.begin();
-        for (auto left = aContainer.size(); left >= subrange; left -= subrange)
+        catch (...)
         {
-            auto end = std::next(next, subrange);
-            aThreadPool.run([next, end, &aFunction]()
-            {
-                for (auto i = next; i != end; ++i)
-                    aFunction(*i);
-            });
-            next = end;
+            free_entry(entry);
+            throw;
         }
-        if (next != aContainer.end())
-            aThreadPool.run([next, &aContainer, &aFunction]()
+        submit(entry);
+        return true;
+    }
+
+    template <typename Function>
+    inline void task_group::run(Function&& aFunction, int32_t aPriority)
+    {
+        ++iOutstanding;
+        auto work = [this, function = std::forward<Function>(aFunction)]() mutable
+        {
+            std::exception_ptr exception;
+            try
+            {
+                function();
+            }
+            catch (...)
             {
-                for (auto i = next; i != aContainer.end(); ++i)
-                    aFunction(*i);
-            });
-        aThreadPool.wait();
+                exception = std::current_exception();
+            }
+            task_done(exception);
+        };
+        try
+        {
+            if (!iThreadPool.post(std::move(work), aPriority))
+                work(); // pool stopped so post() didn't take the work; run it inline
+        }
+        catch (...)
+        {
+            // post() failed (e.g. no_threads) so the work will never run; don't leave it outstanding
+            task_done({});
+            throw;
+        }
     }
 }
@@ -81,6 +81,8 @@ namespace neolib
         bool waiting() const;
         const duration_type& duration() const;
         void set_duration(const duration_type& aDuration_s, bool aEffectiveImmediately = false);
+        const duration_type& slack() const;
+        void set_slack(const duration_type& aSlack_s);
     public:
         void set_debug(bool aDebug);
         // implementation
@@ -100,6 +102,7 @@ namespace neolib
         ref_ptr<i_timer_object> iTimerObject;
         ref_ptr<i_timer_subscriber> iTimerSubscriber;
         duration_type iDuration_s;
+        duration_type iSlack_s;
         bool iEnabled;
         bool iWaiting;
         bool iInReady;
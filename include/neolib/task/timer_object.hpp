@@ -44,8 +44,11 @@
 
 namespace neolib
 {
+    class timer_service;
+
     class NEOLIB_EXPORT timer_object : public lifetime<reference_counted<i_timer_object>>
     {
+        friend class timer_service;
     public:
         timer_object(i_timer_service& aService);
         ~timer_object();
@@ -54,14 +57,26 @@ namespace neolib
         void async_wait(i_timer_subscriber& aSubscriber) override;
         void unsubscribe(i_timer_subscriber& aSubscriber) override;
         void cancel() override;
+        std::optional<std::chrono::steady_clock::time_point> expiry_time() const override;
+        std::chrono::steady_clock::duration slack() const override;
+        void set_slack(const std::chrono::steady_clock::duration& aSlack) override;
     public:
         bool poll() override;
     public:
         bool debug() const override;
         void set_debug(bool aDebug) override;
     private:
-        i_timer_service& iService;
+        void detach_service();
+    private:
+        i_timer_service* iService;
         std::optional<std::chrono::steady_clock::time_point> iExpiryTime;
+        std::chrono::steady_clock::duration iSlack = {};
+        // timer wheel linkage, owned by the timer_service
+        timer_object* iWheelPrevious = nullptr;
+        timer_object* iWheelNext = nullptr;
+        std::uint32_t iWheelSlot = 0;
+        std::uint64_t iWheelTick = 0;
+        std::size_t iServiceIndex = 0;
         mutable std::recursive_mutex iSubscribersMutex;
         std::set<ref_ptr<i_timer_subscriber>> iSubscribers;
 #if !defined(NDEBUG) || defined(DEBUG_TIMER_OBJECTS)
@@ -36,12 +36,90 @@
 #pragma once
 
 #include <neolib/neolib.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 namespace neolib
 {
+    // A thread blocked until one of the things it is waiting on notifies it. A notification
+    // made before the wait is remembered so registering then checking then waiting cannot
+    // miss one.
+    class waiter
+    {
+    public:
+        waiter() : iNotified{ false }
+        {
+        }
+    public:
+        void notify() noexcept
+        {
+            {
+                std::scoped_lock lock{ iMutex };
+                iNotified = true;
+            }
+            iCondVar.notify_one();
+        }
+        // returns false if the deadline passed without a notification
+        bool wait(std::optional<std::chrono::steady_clock::time_point> const& aDeadline = {})
+        {
+            std::unique_lock lock{ iMutex };
+            auto const notified = [&]() { return iNotified; };
+            bool result = true;
+            if (aDeadline)
+                result = iCondVar.wait_until(lock, *aDeadline, notified);
+            else
+                iCondVar.wait(lock, notified);
+            iNotified = false;
+            return result;
+        }
+    private:
+        std::mutex iMutex;
+        std::condition_variable iCondVar;
+        bool iNotified;
+    };
+
+    class waiter_list
+    {
+    public:
+        void add(waiter& aWaiter) const
+        {
+            std::scoped_lock lock{ iMutex };
+            iWaiters.push_back(&aWaiter);
+        }
+        void remove(waiter& aWaiter) const
+        {
+            std::scoped_lock lock{ iMutex };
+            auto existing = std::find(iWaiters.begin(), iWaiters.end(), &aWaiter);
+            if (existing != iWaiters.end())
+                iWaiters.erase(existing);
+        }
+        void notify() const
+        {
+            // a waiter is only destroyed after it has been removed so it cannot go away here
+            std::scoped_lock lock{ iMutex };
+            for (auto w : iWaiters)
+                w->notify();
+        }
+    private:
+        mutable std::mutex iMutex;
+        mutable std::vector<waiter*> iWaiters;
+    };
+
     class waitable
     {
     public:
         virtual bool waitable_ready() const = 0;
+        // returns false if the waitable cannot notify waiters in which case it is polled
+        virtual bool add_waiter(waiter&) const
+        {
+            return false;
+        }
+        virtual void remove_waiter(waiter&) const
+        {
+        }
     };
 }
@@ -40,7 +40,10 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <optional>
 #include <vector>
+#include <span>
 #include <variant>
 #include <neolib/task/i_message_queue.hpp>
 #include <neolib/task/waitable.hpp>
@@ -71,12 +74,52 @@ namespace neolib
         bool msg_wait(const i_message_queue& aMessageQueue) const;
         bool msg_wait(const i_message_queue& aMessageQueue, uint32_t aTimeout_ms) const;
         void reset() const;
+        void add_waiter(waiter& aWaiter) const;
+        void remove_waiter(waiter& aWaiter) const;
     private:
         mutable std::mutex iMutex;
         mutable std::condition_variable iCondVar;
         mutable bool iReady;
         mutable std::size_t iTotalWaiting;
         mutable signal_type iSignalType;
+        waiter_list iWaiters;
+    };
+
+    // Registers a waiter with everything a wait is on for the duration of the wait, whichever way
+    // the wait ends.
+    class scoped_waiter : public waiter
+    {
+    public:
+        scoped_waiter(std::span<const waitable_event* const> aEvents, const i_message_queue* aMessageQueue, const waitable* aWaitable) :
+            iEvents{ aEvents }, iMessageQueue{ aMessageQueue }, iWaitable{ aWaitable }, iPoll{ false }
+        {
+            for (auto e : iEvents)
+                e->add_waiter(*this);
+            if (iMessageQueue != nullptr && !iMessageQueue->add_waiter(*this))
+                iPoll = true;
+            if (iWaitable != nullptr && !iWaitable->add_waiter(*this))
+                iPoll = true;
+        }
+        ~scoped_waiter()
+        {
+            for (auto e : iEvents)
+                e->remove_waiter(*this);
+            if (iMessageQueue != nullptr)
+                iMessageQueue->remove_waiter(*this);
+            if (iWaitable != nullptr)
+                iWaitable->remove_waiter(*this);
+        }
+    public:
+        // true if something waited on cannot notify so the wait must poll
+        bool poll() const
+        {
+            return iPoll;
+        }
+    private:
+        std::span<const waitable_event* const> iEvents;
+        const i_message_queue* iMessageQueue;
+        const waitable* iWaitable;
+        bool iPoll;
     };
 
     struct wait_result_event { wait_result_event(const waitable_event& aEvent) : iEvent(aEvent) {} const waitable_event& iEvent; };
@@ -84,8 +127,11 @@ namespace neolib
     struct wait_result_waitable {};
     typedef std::variant<wait_result_event, wait_result_message, wait_result_waitable> wait_result;
 
+    // Waits block until an event is signalled, a message is posted or the waitable becomes
+    // ready; only sources that cannot notify (e.g. a native message queue) are polled.
     class waitable_event_list
     {
+        friend class waitable_event;
         // types
     private:
         typedef const waitable_event* event_pointer;
@@ -110,6 +156,11 @@ namespace neolib
         wait_result wait(const waitable& aWaitable) const;
         wait_result msg_wait(const i_message_queue& aMessageQueue) const;
         wait_result msg_wait(const i_message_queue& aMessageQueue, const waitable& aWaitable) const;
+        
+        // implementation
+    private:
+        std::optional<wait_result> do_wait(const i_message_queue* aMessageQueue, const waitable* aWaitable, 
+            std::optional<std::chrono::steady_clock::time_point> const& aDeadline = {}) const;
 
         // attributes
     private:
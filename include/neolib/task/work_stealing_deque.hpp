@@ -0,0 +1,179 @@
+// work_stealing_deque.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/lockfree/detail/freelist.hpp>
+
+namespace neolib
+{
+    // Chase-Lev work stealing deque (Le, Pop, Cohen, Nardelli 2013); the owning thread pushes and
+    // pops at the bottom, any other thread may steal from the top. T must be trivially copyable.
+    template <typename T>
+    class work_stealing_deque
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "neolib::work_stealing_deque: T must be trivially copyable");
+        // types
+    public:
+        typedef T value_type;
+    private:
+        class buffer
+        {
+        public:
+            buffer(std::int64_t aCapacity) :
+                iCapacity{ aCapacity }, iMask{ aCapacity - 1 }, iItems{ std::make_unique<std::atomic<T>[]>(static_cast<std::size_t>(aCapacity)) }
+            {
+            }
+        public:
+            std::int64_t capacity() const
+            {
+                return iCapacity;
+            }
+            T get(std::int64_t aIndex) const
+            {
+                return iItems[aIndex & iMask].load(std::memory_order_relaxed);
+            }
+            void put(std::int64_t aIndex, T aItem)
+            {
+                iItems[aIndex & iMask].store(aItem, std::memory_order_relaxed);
+            }
+            std::unique_ptr<buffer> grow(std::int64_t aBottom, std::int64_t aTop) const
+            {
+                auto result = std::make_unique<buffer>(iCapacity * 2);
+                for (auto i = aTop; i != aBottom; ++i)
+                    result->put(i, get(i));
+                return result;
+            }
+        private:
+            std::int64_t const iCapacity;
+            std::int64_t const iMask;
+            std::unique_ptr<std::atomic<T>[]> iItems;
+        };
+        // constants
+    public:
+        static constexpr std::int64_t kDefaultCapacity = 256;
+        // construction
+    public:
+        work_stealing_deque(std::int64_t aInitialCapacity = kDefaultCapacity) :
+            iTop{ 0 }, iBottom{ 0 }
+        {
+            std::int64_t capacity = 1;
+            while (capacity < aInitialCapacity)
+                capacity *= 2;
+            iBuffers.push_back(std::make_unique<buffer>(capacity));
+            iBuffer.store(iBuffers.back().get(), std::memory_order_relaxed);
+        }
+        work_stealing_deque(work_stealing_deque const&) = delete;
+        work_stealing_deque& operator=(work_stealing_deque const&) = delete;
+        // operations
+    public:
+        bool empty() const
+        {
+            return size() == 0;
+        }
+        std::size_t size() const
+        {
+            auto const bottom = iBottom.load(std::memory_order_relaxed);
+            auto const top = iTop.load(std::memory_order_relaxed);
+            return static_cast<std::size_t>(bottom >= top ? bottom - top : 0);
+        }
+        // owner thread only
+        void push(T aItem)
+        {
+            auto const bottom = iBottom.load(std::memory_order_relaxed);
+            auto const top = iTop.load(std::memory_order_acquire);
+            auto* b = iBuffer.load(std::memory_order_relaxed);
+            if (bottom - top > b->capacity() - 1)
+            {
+                // old buffers are retained as a concurrent thief may still be reading from them
+                iBuffers.push_back(b->grow(bottom, top));
+                b = iBuffers.back().get();
+                iBuffer.store(b, std::memory_order_release);
+            }
+            b->put(bottom, aItem);
+            std::atomic_thread_fence(std::memory_order_release);
+            iBottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        // owner thread only
+        bool pop(T& aItem)
+        {
+            auto const bottom = iBottom.load(std::memory_order_relaxed) - 1;
+            auto* b = iBuffer.load(std::memory_order_relaxed);
+            iBottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto top = iTop.load(std::memory_order_relaxed);
+            if (top > bottom)
+            {
+                iBottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+            T item = b->get(bottom);
+            if (top == bottom)
+            {
+                bool const won = iTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                iBottom.store(bottom + 1, std::memory_order_relaxed);
+                if (!won)
+                    return false;
+            }
+            aItem = item;
+            return true;
+        }
+        // any thread
+        bool steal(T& aItem)
+        {
+            auto top = iTop.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto const bottom = iBottom.load(std::memory_order_acquire);
+            if (top >= bottom)
+                return false;
+            auto* b = iBuffer.load(std::memory_order_acquire);
+            T item = b->get(top);
+            if (!iTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return false;
+            aItem = item;
+            return true;
+        }
+        // attributes
+    private:
+        alignas(BOOST_LOCKFREE_CACHELINE_BYTES) std::atomic<std::int64_t> iTop;
+        alignas(BOOST_LOCKFREE_CACHELINE_BYTES) std::atomic<std::int64_t> iBottom;
+        std::atomic<buffer*> iBuffer;
+        std::vector<std::unique_ptr<buffer>> iBuffers;
+    };
+}
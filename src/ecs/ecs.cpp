@@ -52,6 +52,16 @@ namespace neolib::ecs
         return iArchetypeRegistry;
     }
 
+    const ecs::archetype_storages_t& ecs::archetype_storages() const
+    {
+        return iArchetypeStorages;
+    }
+
+    ecs::archetype_storages_t& ecs::archetype_storages()
+    {
+        return iArchetypeStorages;
+    }
+
     const ecs::component_factories_t& ecs::component_factories() const
     {
         return iComponentFactories;
@@ -125,6 +135,26 @@ namespace neolib::ecs
         return const_cast<i_entity_archetype&>(to_const(*this).archetype(aArchetypeId));
     }
 
+    bool ecs::archetype_storage_instantiated(entity_archetype_id aArchetypeId) const
+    {
+        std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
+        return archetype_storages().find(aArchetypeId) != archetype_storages().end();
+    }
+
+    const i_archetype_storage& ecs::archetype_storage(entity_archetype_id aArchetypeId) const
+    {
+        std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
+        auto existingStorage = archetype_storages().find(aArchetypeId);
+        if (existingStorage != archetype_storages().end())
+            return *existingStorage->second;
+        throw entity_archetype_not_found();
+    }
+
+    i_archetype_storage& ecs::archetype_storage(entity_archetype_id aArchetypeId)
+    {
+        return const_cast<i_archetype_storage&>(to_const(*this).archetype_storage(aArchetypeId));
+    }
+
     bool ecs::component_instantiated(component_id aComponentId) const
     {
         return components().find(aComponentId) != components().end();
@@ -187,6 +217,7 @@ namespace neolib::ecs
             auto& newSystem = *iSystems.emplace(aSystemId, existingFactory->second()).first->second;
             if (all_systems_paused())
                 newSystem.pause();
+            iSystemScheduler.add_system(newSystem);
             return newSystem;
         }
         throw system_not_found();
@@ -216,16 +247,21 @@ namespace neolib::ecs
     }
 
     ecs::ecs(ecs_flags aCreationFlags) :
+        iNextSystemThreadIndex{ 0 },
         iFlags{ aCreationFlags }, iNextEntityId { null_entity }, iNextHandleId{ null_id },
+        iSystemScheduler{ *this },
         iSystemTimer
         {
             service<i_async_task>(),
             [this](neolib::callback_timer& aTimer)
             {
                 aTimer.again();
-                for (auto& system : systems())
-                    if (system.second->can_apply())
-                        system.second->apply();
+                if ((flags() & ecs_flags::ParallelSystems) == ecs_flags::ParallelSystems)
+                    iSystemScheduler.run();
+                else
+                    for (auto& system : systems())
+                        if (system.second->can_apply())
+                            system.second->apply();
                 commit_async_entity_destruction();
                 commit_async_entity_creation();
             }, std::chrono::milliseconds{1}, true
@@ -262,17 +298,55 @@ namespace neolib::ecs
         return *iThreadPool;
     }
 
+    neolib::thread_placement ecs::system_thread_placement() const
+    {
+        std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
+        return iSystemThreadPlacement;
+    }
+
+    void ecs::set_system_thread_placement(neolib::thread_placement const& aPlacement)
+    {
+        std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
+        iSystemThreadPlacement = aPlacement;
+    }
+
+    std::size_t ecs::place_system_thread(neolib::thread& aSystemThread)
+    {
+        std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
+        // the lowest index no live system thread is using so placement fills the CPUs of ended system threads first
+        std::size_t placementIndex = iNextSystemThreadIndex;
+        if (!iFreeSystemThreadIndices.empty())
+        {
+            placementIndex = *iFreeSystemThreadIndices.begin();
+            iFreeSystemThreadIndices.erase(iFreeSystemThreadIndices.begin());
+        }
+        else
+            ++iNextSystemThreadIndex;
+        if (iSystemThreadPlacement != neolib::thread_placement::any())
+            aSystemThread.set_affinity(iSystemThreadPlacement.affinity(placementIndex));
+        return placementIndex;
+    }
+
+    void ecs::release_system_thread(std::size_t aPlacementIndex)
+    {
+        std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
+        iFreeSystemThreadIndices.insert(aPlacementIndex);
+    }
+
     ecs_flags ecs::flags() const
     {
         return iFlags;
     }
 
-    entity_id ecs::create_entity(const entity_archetype_id& aArchetypeId)
+    entity_id ecs::create_entity(const entity_archetype_id& aArchetypeId, bool aNotify)
     {
         auto entityId = next_entity_id();
         if ((flags() & ecs_flags::PopulateEntityInfo) == ecs_flags::PopulateEntityInfo)
             component<entity_info>().populate(entityId, entity_info{ aArchetypeId, system<time>().world_time() });
-        EntityCreated.trigger(entityId);
+        if (archetype_storage_instantiated(aArchetypeId))
+            archetype_storage(aArchetypeId).add_entity(entityId);
+        if (aNotify)
+            EntityCreated.trigger(entityId);
         return entityId;
     }
 
@@ -303,6 +377,9 @@ namespace neolib::ecs
         for (auto& component : iComponents)
             if (component.second->has_entity_record(aEntityId))
                 component.second->destroy_entity_record(aEntityId);
+        for (auto& storage : iArchetypeStorages)
+            if (storage.second->has_entity(aEntityId))
+                storage.second->destroy_entity(aEntityId);
         free_entity_id(aEntityId);
     }
 
@@ -328,7 +405,7 @@ namespace neolib::ecs
 
     bool ecs::run_threaded(const system_id& aSystemId) const
     {
-        return (flags() & ecs_flags::NoThreads) != ecs_flags::NoThreads;
+        return (flags() & (ecs_flags::NoThreads | ecs_flags::ParallelSystems)) == ecs_flags::None;
     }
 
     bool ecs::all_systems_paused() const
@@ -388,6 +465,16 @@ namespace neolib::ecs
             throw uuid_exists("register_archetype");
     }
 
+    void ecs::register_archetype_storage(std::unique_ptr<i_archetype_storage> aStorage)
+    {
+        std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
+        auto const id = aStorage->id();
+        auto& storage = *aStorage;
+        if (!archetype_storages().emplace(id, std::move(aStorage)).second)
+            throw uuid_exists("register_archetype_storage");
+        iComponentMutexes.emplace_back(storage.mutex());
+    }
+
     bool ecs::component_registered(component_id aComponentId) const
     {
         std::scoped_lock<neolib::recursive_spinlock> lock{ mutex() };
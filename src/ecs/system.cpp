@@ -34,13 +34,15 @@
  */
 
 #include <neolib/neolib.hpp>
+#include <neolib/ecs/i_ecs.hpp>
 #include <neolib/ecs/system.hpp>
 
 namespace neolib::ecs
 {
     thread::thread(i_system& aOwner) : 
-        async_task{ "neolib::ecs::thread" }, async_thread{ *this, "neolib::ecs::thread" }, iOwner{ aOwner }
+        async_task{ "neolib::ecs::thread" }, async_thread{ *this, "neolib::ecs " + aOwner.name().to_std_string() }, iOwner{ aOwner }, iPlacementIndex{ 0 }
     {
+        iPlacementIndex = iOwner.ecs().place_system_thread(*this);
         start();
     }
 
@@ -49,6 +51,7 @@ namespace neolib::ecs
         set_destroying();
         if (iOwner.waiting())
             iOwner.signal();
+        iOwner.ecs().release_system_thread(iPlacementIndex);
     }
 
     bool thread::do_work(neolib::yield_type aYieldType)
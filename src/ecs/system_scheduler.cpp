@@ -0,0 +1,106 @@
+// system_scheduler.cpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <neolib/neolib.hpp>
+#include <neolib/ecs/i_ecs.hpp>
+#include <neolib/ecs/system_scheduler.hpp>
+
+namespace neolib::ecs
+{
+    system_scheduler::system_scheduler(i_ecs& aEcs) :
+        iEcs{ aEcs }, iDirty{ false }
+    {
+    }
+
+    system_scheduler::~system_scheduler()
+    {
+    }
+
+    std::size_t system_scheduler::system_count() const
+    {
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        return iSystems.size();
+    }
+
+    void system_scheduler::add_system(i_system& aSystem)
+    {
+        std::scoped_lock<std::mutex> lock{ iMutex };
+        iSystems.push_back(&aSystem);
+        iDirty = true;
+    }
+
+    void system_scheduler::run()
+    {
+        std::shared_ptr<neolib::task_graph> graph;
+        {
+            std::scoped_lock<std::mutex> lock{ iMutex };
+            if (iDirty || !iGraph)
+                build();
+            graph = iGraph;
+        }
+        // a system added while this frame runs gets a new graph rather than rebuilding this one
+        graph->run();
+    }
+
+    bool system_scheduler::conflicts(i_system const& aFirst, i_system const& aSecond)
+    {
+        for (auto const& component : aFirst.components())
+        {
+            if (aSecond.components().find(component) == aSecond.components().end())
+                continue;
+            if (aFirst.written_components().find(component) != aFirst.written_components().end() ||
+                aSecond.written_components().find(component) != aSecond.written_components().end())
+                return true;
+        }
+        return false;
+    }
+
+    void system_scheduler::build()
+    {
+        auto graph = std::make_shared<neolib::task_graph>(iEcs.thread_pool());
+        for (auto system : iSystems)
+            graph->add_node([system]()
+            {
+                if (system->can_apply())
+                    system->apply();
+            });
+        for (task_graph::node_id later = 1; later < iSystems.size(); ++later)
+            for (task_graph::node_id earlier = 0; earlier < later; ++earlier)
+                if (conflicts(*iSystems[earlier], *iSystems[later]))
+                    graph->add_edge(earlier, later);
+        iGraph = graph;
+        iDirty = false;
+    }
+}
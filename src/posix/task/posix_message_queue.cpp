@@ -0,0 +1,98 @@
+// posix_message_queue.cpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <neolib/core/scoped.hpp>
+#include "posix_message_queue.hpp"
+
+namespace neolib
+{
+    posix_message_queue::posix_message_queue(async_task& aIoTask, std::function<bool()> aIdleFunction) :
+        iIoTask{ aIoTask },
+        iIdleFunction{ aIdleFunction },
+        iMessages{ 0u },
+        iInIdle{ false }
+    {
+    }
+
+    bool posix_message_queue::have_message() const
+    {
+        return iMessages.load(std::memory_order_acquire) != 0u;
+    }
+
+    int posix_message_queue::get_message() const
+    {
+        std::unique_lock lock{ iMutex };
+        iCondVar.wait(lock, [&]() { return have_message(); });
+        iMessages.fetch_sub(1u, std::memory_order_acq_rel);
+        return 1;
+    }
+
+    void posix_message_queue::bump()
+    {
+        {
+            std::scoped_lock lock{ iMutex };
+            iMessages.fetch_add(1u, std::memory_order_acq_rel);
+        }
+        iCondVar.notify_one();
+        iWaiters.notify();
+        iIoTask.wake();
+    }
+
+    bool posix_message_queue::in_idle() const
+    {
+        return iInIdle;
+    }
+
+    void posix_message_queue::idle()
+    {
+        if (!in_idle() && iIdleFunction)
+        {
+            scoped_flag sf{ iInIdle };
+            iIdleFunction();
+        }
+    }
+
+    bool posix_message_queue::add_waiter(waiter& aWaiter) const
+    {
+        iWaiters.add(aWaiter);
+        return true;
+    }
+
+    void posix_message_queue::remove_waiter(waiter& aWaiter) const
+    {
+        iWaiters.remove(aWaiter);
+    }
+}
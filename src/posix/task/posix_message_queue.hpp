@@ -0,0 +1,72 @@
+// posix_message_queue.hpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <neolib/neolib.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <neolib/task/async_task.hpp>
+#include <neolib/task/i_message_queue.hpp>
+#include <neolib/task/waitable.hpp>
+
+namespace neolib
+{
+    // There is no native message queue on POSIX so messages are counted here; posting one
+    // wakes the task and anything waiting on the queue rather than being polled for.
+    class posix_message_queue : public i_message_queue
+    {
+    public:
+        posix_message_queue(async_task& aIoTask, std::function<bool()> aIdleFunction);
+    public:
+        bool have_message() const override;
+        int get_message() const override;
+        void bump() override;
+        bool in_idle() const override;
+        void idle() override;
+        bool add_waiter(waiter& aWaiter) const override;
+        void remove_waiter(waiter& aWaiter) const override;
+    private:
+        async_task& iIoTask;
+        std::function<bool()> iIdleFunction;
+        mutable std::mutex iMutex;
+        mutable std::condition_variable iCondVar;
+        mutable std::atomic<std::size_t> iMessages;
+        waiter_list iWaiters;
+        bool iInIdle;
+    };
+}
@@ -34,6 +34,7 @@
 */
 
 #include <neolib/neolib.hpp>
+#include <bit>
 #include <boost/asio.hpp>
 #include <neolib/core/scoped.hpp>
 #include <neolib/task/thread.hpp>
@@ -43,6 +44,8 @@
 
 #ifdef _WIN32
 #include "../win32/task/win32_message_queue.hpp"
+#else
+#include "../posix/task/posix_message_queue.hpp"
 #endif
 
 namespace neolib
@@ -59,6 +62,8 @@ namespace neolib
     public:
         bool poll(bool aProcessEvents = true, std::size_t aMaximumPollCount = kDefaultPollCount) override;
         void* native_object() override;
+        void wait(std::optional<std::chrono::steady_clock::time_point> const& aDeadline);
+        void wake();
         // attributes
     private:
         async_task& iTask;
@@ -96,10 +101,42 @@ namespace neolib
         return &iNativeIoService;
     }
 
+    void io_service::wait(std::optional<std::chrono::steady_clock::time_point> const& aDeadline)
+    {
+        // the work guard stops the io service returning straight away when it has no outstanding operations
+        auto const workGuard = boost::asio::make_work_guard(iNativeIoService);
+        iNativeIoService.restart();
+        if (aDeadline)
+            iNativeIoService.run_one_until(*aDeadline);
+        else
+            iNativeIoService.run_one();
+    }
+
+    void io_service::wake()
+    {
+        boost::asio::post(iNativeIoService, []() {});
+    }
+
     timer_service::timer_service(async_task& aTask, bool aMultiThreaded) :
         iTask{ aTask },
-        iTaskDestroying{ aTask }
+        iTaskDestroying{ aTask },
+        iEpoch{ std::chrono::steady_clock::now() },
+        iCurrentTick{ 0u },
+        iWheelCount{ 0u },
+        iLists{},
+        iOccupied{}
+    {
+    }
+
+    timer_service::~timer_service()
     {
+        std::unique_lock lock{ iMutex };
+        for (auto& o : iObjects)
+        {
+            auto& object = static_cast<timer_object&>(*o);
+            unlink(object);
+            object.detach_service();
+        }
     }
 
     bool timer_service::poll(bool aProcessEvents, std::size_t aMaximumPollCount)
@@ -123,8 +160,15 @@ namespace neolib
             work_list_t& workList = *workListStack[stack - 1];
 
             std::unique_lock lock{ iMutex };
-            iObjects.erase(std::remove_if(iObjects.begin(), iObjects.end(), [](auto const& o) { return o == nullptr; }), iObjects.end());
-            std::transform(iObjects.begin(), iObjects.end(), std::back_inserter(workList), [](auto const& s) { return std::make_pair(s, destroyed_flag{ *s }); });
+            advance(tick(std::chrono::steady_clock::now(), false));
+            // timers left over when the poll count is exhausted stay on the expired list
+            while (aMaximumPollCount == 0 || workList.size() < iterationsLeft)
+            {
+                auto const expired = take(kExpiredList);
+                if (expired == nullptr)
+                    break;
+                workList.emplace_back(ref_ptr<i_timer_object>{ *expired }, destroyed_flag{ *expired });
+            }
             lock.unlock();
             for (auto const& o : workList)
             {
@@ -134,8 +178,8 @@ namespace neolib
                 if (object.poll())
                 {
                     didSomeThisIteration = true;
-                    if (aMaximumPollCount != 0 && --iterationsLeft == 0)
-                        break;
+                    if (aMaximumPollCount != 0)
+                        --iterationsLeft;
                 }
             }
             lock.lock();
@@ -157,28 +201,265 @@ namespace neolib
         if (iTaskDestroying)
             throw task_destroying();
         std::unique_lock lock{ iMutex };
-        iObjects.push_back(make_ref<timer_object>(*this));
+        auto newObject = make_ref<timer_object>(*this);
+        newObject->iServiceIndex = iObjects.size();
+        iObjects.push_back(newObject);
         return *iObjects.back();
     }
 
+    std::optional<std::chrono::steady_clock::time_point> timer_service::next_deadline() const
+    {
+        std::unique_lock lock{ iMutex };
+        auto const next = next_tick();
+        if (!next)
+            return {};
+        return time(*next);
+    }
+
+    void timer_service::deadline_changed(i_timer_object& aObject)
+    {
+        auto& object = static_cast<timer_object&>(aObject);
+        {
+            std::unique_lock lock{ iMutex };
+            if (object.iService != this)
+                return;
+            auto const previous = next_tick();
+            unlink(object);
+            if (!object.iExpiryTime)
+                return;
+            link(object);
+            // a task already due to wake no later than this timer need not be disturbed
+            if (previous && *previous <= object.iWheelTick)
+                return;
+        }
+        // a blocked task must recalculate how long it can wait for
+        iTask.wake();
+    }
+
     void timer_service::remove_timer_object(i_timer_object& aObject)
     {
+        ref_ptr<i_timer_object> existingRef;
         std::unique_lock lock{ iMutex };
-        auto existing = std::find_if(iObjects.begin(), iObjects.end(), [&aObject](auto&& o) { return o == &aObject; });
-        if (existing != iObjects.end())
+        auto& object = static_cast<timer_object&>(aObject);
+        if (object.iService != this)
+            return;
+        unlink(object);
+        object.detach_service();
+        auto const index = object.iServiceIndex;
+        existingRef = std::move(iObjects[index]);
+        if (index != iObjects.size() - 1u)
         {
-            auto existingRef = std::move(*existing);
-            iObjects.erase(existing);
+            iObjects[index] = std::move(iObjects.back());
+            static_cast<timer_object&>(*iObjects[index]).iServiceIndex = index;
+        }
+        iObjects.pop_back();
+        lock.unlock();
+    }
+
+    std::uint64_t timer_service::tick(std::chrono::steady_clock::time_point aTime, bool aRoundUp) const
+    {
+        if (aTime <= iEpoch)
+            return 0u;
+        auto const elapsed = aTime - iEpoch;
+        auto result = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+        if (aRoundUp && std::chrono::milliseconds{ result } < elapsed)
+            ++result;
+        return result;
+    }
+
+    std::chrono::steady_clock::time_point timer_service::time(std::uint64_t aTick) const
+    {
+        return iEpoch + std::chrono::milliseconds{ aTick };
+    }
+
+    std::optional<std::uint64_t> timer_service::next_tick() const
+    {
+        if (iLists[kExpiredList] != nullptr)
+            return iCurrentTick;
+        if (iWheelCount == 0u)
+            return {};
+        // for the upper levels (and the overflow list) this is the tick at which the slot
+        // cascades which is never later than the earliest deadline it contains
+        std::optional<std::uint64_t> result;
+        for (std::uint32_t level = 0u; level < kWheelLevels; ++level)
+        {
+            auto const distance = next_occupied(level);
+            if (!distance)
+                continue;
+            auto const shift = level * kWheelSlotBits;
+            auto const slotTick = ((iCurrentTick >> shift) + *distance) << shift;
+            if (!result || slotTick < *result)
+                result = slotTick;
+        }
+        if (iLists[kOverflowList] != nullptr)
+        {
+            auto const shift = kWheelLevels * kWheelSlotBits;
+            auto const overflowTick = ((iCurrentTick >> shift) + 1u) << shift;
+            if (!result || overflowTick < *result)
+                result = overflowTick;
+        }
+        return result;
+    }
+
+    void timer_service::link(timer_object& aObject)
+    {
+        // rounding up means a timer never fires before its deadline
+        auto deadline = tick(*aObject.iExpiryTime, true);
+        if (aObject.iSlack > std::chrono::steady_clock::duration::zero())
+        {
+            // choose the tick in [deadline, latest] with the most trailing zero bits
+            auto const latest = tick(*aObject.iExpiryTime + aObject.iSlack, false);
+            if (latest > deadline)
+            {
+                auto const mask = (std::uint64_t{ 1u } << std::bit_width(deadline ^ latest)) - 1u;
+                if ((deadline & mask) != 0u)
+                    deadline = latest & ~(mask >> 1u);
+            }
+        }
+        aObject.iWheelTick = deadline;
+        if (deadline <= iCurrentTick)
+        {
+            link(aObject, kExpiredList);
+            return;
+        }
+        for (std::uint32_t level = 0u; level < kWheelLevels; ++level)
+        {
+            auto const shift = level * kWheelSlotBits;
+            if ((deadline >> shift) - (iCurrentTick >> shift) < kWheelSlots)
+            {
+                link(aObject, kFirstWheelList + level * kWheelSlots + static_cast<std::uint32_t>((deadline >> shift) & (kWheelSlots - 1u)));
+                return;
+            }
+        }
+        link(aObject, kOverflowList);
+    }
+
+    void timer_service::link(timer_object& aObject, std::uint32_t aList)
+    {
+        auto& head = iLists[aList];
+        aObject.iWheelPrevious = nullptr;
+        aObject.iWheelNext = head;
+        if (head != nullptr)
+            head->iWheelPrevious = &aObject;
+        head = &aObject;
+        aObject.iWheelSlot = aList + 1u;
+        if (aList != kExpiredList)
+            ++iWheelCount;
+        if (aList >= kFirstWheelList)
+        {
+            auto const slot = aList - kFirstWheelList;
+            iOccupied[slot / kWheelSlots][(slot % kWheelSlots) / 64u] |= (1ull << (slot % 64u));
+        }
+    }
+
+    void timer_service::unlink(timer_object& aObject)
+    {
+        if (aObject.iWheelSlot == 0u)
+            return;
+        auto const list = aObject.iWheelSlot - 1u;
+        auto& head = iLists[list];
+        if (aObject.iWheelPrevious != nullptr)
+            aObject.iWheelPrevious->iWheelNext = aObject.iWheelNext;
+        else
+            head = aObject.iWheelNext;
+        if (aObject.iWheelNext != nullptr)
+            aObject.iWheelNext->iWheelPrevious = aObject.iWheelPrevious;
+        aObject.iWheelPrevious = nullptr;
+        aObject.iWheelNext = nullptr;
+        aObject.iWheelSlot = 0u;
+        if (list != kExpiredList)
+            --iWheelCount;
+        if (list >= kFirstWheelList && head == nullptr)
+        {
+            auto const slot = list - kFirstWheelList;
+            iOccupied[slot / kWheelSlots][(slot % kWheelSlots) / 64u] &= ~(1ull << (slot % 64u));
+        }
+    }
+
+    timer_object* timer_service::take(std::uint32_t aList)
+    {
+        auto const result = iLists[aList];
+        if (result != nullptr)
+            unlink(*result);
+        return result;
+    }
+
+    std::optional<std::uint32_t> timer_service::next_occupied(std::uint32_t aLevel) const
+    {
+        // distance (1 to kWheelSlots - 1) from the current slot to the next occupied slot
+        auto const& occupied = iOccupied[aLevel];
+        auto const current = static_cast<std::uint32_t>((iCurrentTick >> (aLevel * kWheelSlotBits)) & (kWheelSlots - 1u));
+        auto const from = (current + 1u) & (kWheelSlots - 1u);
+        auto const words = static_cast<std::uint32_t>(occupied.size());
+        for (std::uint32_t n = 0u; n <= words; ++n)
+        {
+            auto const word = (from / 64u + n) % words;
+            auto bits = occupied[word];
+            if (n == 0u)
+                bits &= (~0ull << (from % 64u));
+            else if (n == words)
+                bits &= (from % 64u != 0u ? (1ull << (from % 64u)) - 1ull : 0ull);
+            if (bits != 0ull)
+            {
+                auto const slot = word * 64u + static_cast<std::uint32_t>(std::countr_zero(bits));
+                return ((slot - current) & (kWheelSlots - 1u));
+            }
+        }
+        return {};
+    }
+
+    void timer_service::advance(std::uint64_t aTick)
+    {
+        while (iCurrentTick < aTick)
+        {
+            if (iWheelCount == 0u)
+            {
+                iCurrentTick = aTick;
+                return;
+            }
+            auto const boundary = (iCurrentTick | (kWheelSlots - 1u)) + 1u;
+            auto const limit = std::min(aTick, boundary);
+            auto const distance = next_occupied(0u);
+            if (distance && iCurrentTick + *distance < limit)
+                iCurrentTick += *distance;
+            else
+            {
+                iCurrentTick = limit;
+                if (iCurrentTick == boundary)
+                    cascade();
+            }
+            auto const list = kFirstWheelList + static_cast<std::uint32_t>(iCurrentTick & (kWheelSlots - 1u));
+            while (auto const expired = take(list))
+                link(*expired, kExpiredList);
         }
     }
 
+    void timer_service::cascade()
+    {
+        // redistribute the upper level slots that the current tick has reached, highest first
+        auto relink = [&](std::uint32_t aList)
+        {
+            while (auto const object = take(aList))
+                link(*object);
+        };
+        std::uint32_t levels = 1u;
+        while (levels < kWheelLevels && (iCurrentTick & ((1ull << (levels * kWheelSlotBits)) - 1ull)) == 0ull)
+            ++levels;
+        if (levels == kWheelLevels && (iCurrentTick & ((1ull << (kWheelLevels * kWheelSlotBits)) - 1ull)) == 0ull)
+            relink(kOverflowList);
+        for (auto level = levels - 1u; level >= 1u; --level)
+            relink(kFirstWheelList + level * kWheelSlots + static_cast<std::uint32_t>((iCurrentTick >> (level * kWheelSlotBits)) & (kWheelSlots - 1u)));
+    }
+
     async_task::async_task(const std::string& aName) :
-        task{ aName }, iThread{ nullptr }, iState{ async_task_state::Init }
+        task{ aName }, iThread{ nullptr }, iReadyEventQueues{ nullptr }, 
+        iReactorMode{ false }, iBlocked{ false }, iWakeRequested{ false }, iWakeSignalled{ false }, iState{ async_task_state::Init }
     {
     }
 
     async_task::async_task(i_thread& aThread, const std::string& aName) :
-        task{ aName }, iThread{ &aThread }, iState{ async_task_state::Init }
+        task{ aName }, iThread{ &aThread }, iReadyEventQueues{ nullptr }, 
+        iReactorMode{ false }, iBlocked{ false }, iWakeRequested{ false }, iWakeSignalled{ false }, iState{ async_task_state::Init }
     {
     }
 
@@ -230,7 +511,8 @@ namespace neolib
     {
         if (halted())
             return false;
-        bool didSome = pump_events();
+        bool didSome = pump_posted();
+        didSome = (pump_events() || didSome);
         didSome = (pump_messages() || didSome);
         if (iTimerService)
             didSome = (iTimerService->poll() || didSome);
@@ -242,6 +524,8 @@ namespace neolib
                 this_thread::yield();
             else if (aYieldIfNoWork == yield_type::Sleep)
                 this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+            else if (aYieldIfNoWork == yield_type::Wait)
+                wait_for_work();
         }
         return didSome;
     }
@@ -260,6 +544,8 @@ namespace neolib
     {
         #ifdef _WIN32
         iMessageQueue = std::make_unique<win32_message_queue>(*this, aIdleFunction);
+        #else
+        iMessageQueue = std::make_unique<posix_message_queue>(*this, aIdleFunction);
         #endif
         return message_queue();
     }
@@ -292,15 +578,55 @@ namespace neolib
         auto existing = std::find(iEventQueues.begin(), iEventQueues.end(), &aQueue);
         if (existing != iEventQueues.end())
             iEventQueues.erase(existing);
+        // the queue may be in the ready list
+        i_async_event_queue* others = nullptr;
+        for (auto eventQueue = take_ready_event_queues(); eventQueue != nullptr;)
+        {
+            auto const next = eventQueue->next_ready();
+            if (eventQueue != &aQueue)
+            {
+                eventQueue->set_next_ready(others);
+                others = eventQueue;
+            }
+            eventQueue = next;
+        }
+        push_ready_event_queues(others);
+    }
+
+    void async_task::event_queue_ready(i_async_event_queue& aQueue)
+    {
+        auto head = iReadyEventQueues.load(std::memory_order_relaxed);
+        do
+        {
+            aQueue.set_next_ready(head);
+        } while (!iReadyEventQueues.compare_exchange_weak(head, &aQueue, std::memory_order_release, std::memory_order_relaxed));
+        wake();
     }
 
     bool async_task::pump_events()
     {
+        // only queues that have become ready since the last pump are visited; nothing is locked if there are none
+        if (iReadyEventQueues.load(std::memory_order_acquire) == nullptr)
+            return false;
         bool didSome = false;
+        std::scoped_lock lock{ iMutex };
+        auto eventQueue = take_ready_event_queues();
+        try
         {
-            std::scoped_lock lock{ iMutex };
-            for (auto eventQueue : iEventQueues)
-                didSome = (eventQueue->pump_events() || didSome);
+            while (eventQueue != nullptr)
+            {
+                auto const next = eventQueue->next_ready();
+                eventQueue->set_next_ready(nullptr);
+                eventQueue->reset_ready();
+                auto const pumped = eventQueue;
+                eventQueue = next;
+                didSome = (pumped->pump_events() || didSome);
+            }
+        }
+        catch (...)
+        {
+            push_ready_event_queues(eventQueue);
+            throw;
         }
         return didSome;
     }
@@ -321,6 +647,41 @@ namespace neolib
         return didWork;
     }
 
+    void async_task::post(std::function<void()> aFunction)
+    {
+        {
+            std::scoped_lock lock{ iPostedMutex };
+            iPosted.push_back(std::move(aFunction));
+        }
+        wake();
+    }
+
+    void async_task::wake()
+    {
+        // pairs with wait_for_work(): either the waiter sees the request before blocking or we see that it
+        // is blocked and signal it
+        iWakeRequested.store(true);
+        if (!iBlocked.load() || iWakeSignalled.exchange(true))
+            return;
+        {
+            std::scoped_lock lock{ iWakeMutex };
+            if (iIoService)
+                static_cast<neolib::io_service&>(*iIoService).wake();
+        }
+        iWakeConditionVariable.notify_one();
+    }
+
+    bool async_task::reactor_mode() const noexcept
+    {
+        return iReactorMode;
+    }
+
+    void async_task::set_reactor_mode(bool aReactorMode)
+    {
+        iReactorMode = aReactorMode;
+        wake();
+    }
+
     bool async_task::running() const noexcept
     {
         return iState == async_task_state::Running;
@@ -333,7 +694,8 @@ namespace neolib
 
     void async_task::halt()
     {
-        iState = async_task_state::Halted;
+        set_state(async_task_state::Halted);
+        wake();
     }
 
     bool async_task::finished() const noexcept
@@ -343,8 +705,8 @@ namespace neolib
 
     void async_task::wait() const noexcept
     {
-        while (!finished() && !cancelled())
-            std::this_thread::yield();
+        std::unique_lock lock{ iStateMutex };
+        iStateChanged.wait(lock, [&]() { return finished() || cancelled(); });
     }
 
     void async_task::set_destroying()
@@ -367,20 +729,129 @@ namespace neolib
 
     void async_task::run(yield_type aYieldType)
     {
-        iState = async_task_state::Running;
+        set_state(async_task_state::Running);
         while (!finished() && !cancelled())
-            do_work(aYieldType);
+            do_work(reactor_mode() ? yield_type::Wait : aYieldType);
         detach();
-        iState = async_task_state::Finished;
+        set_state(async_task_state::Finished);
     }
 
     void async_task::cancel() noexcept
     {
         base_type::cancel();
-        while (running())
-            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+        {
+            // as set_state(): wait() may be between checking cancelled() and blocking
+            std::scoped_lock lock{ iStateMutex };
+        }
+        iStateChanged.notify_all();
+        wake();
+        {
+            std::unique_lock lock{ iStateMutex };
+            iStateChanged.wait(lock, [&]() { return !running(); });
+        }
         iTimerService.reset();
-        iIoService.reset();
+        std::unique_ptr<i_async_service> ioService;
+        {
+            // wake() may be using the io service
+            std::scoped_lock lock{ iWakeMutex };
+            std::swap(ioService, iIoService);
+        }
+    }
+
+    bool async_task::pump_posted()
+    {
+        typedef std::vector<std::function<void()>> work_list;
+        thread_local std::vector<std::unique_ptr<work_list>> workLists;
+        thread_local std::size_t stack;
+        scoped_counter<std::size_t> stackCounter{ stack };
+        if (workLists.size() < stack)
+            workLists.push_back(std::make_unique<work_list>());
+        auto& workList = *workLists[stack - 1];
+        {
+            std::scoped_lock lock{ iPostedMutex };
+            workList.swap(iPosted);
+        }
+        for (auto& function : workList)
+            function();
+        bool const didSome = !workList.empty();
+        workList.clear();
+        return didSome;
+    }
+
+    i_async_event_queue* async_task::take_ready_event_queues()
+    {
+        // the list is taken whole so it cannot suffer ABA; reverse it so that queues are visited in the order they became ready
+        i_async_event_queue* result = nullptr;
+        auto eventQueue = iReadyEventQueues.exchange(nullptr, std::memory_order_acquire);
+        while (eventQueue != nullptr)
+        {
+            auto const next = eventQueue->next_ready();
+            eventQueue->set_next_ready(result);
+            result = eventQueue;
+            eventQueue = next;
+        }
+        return result;
+    }
+
+    void async_task::push_ready_event_queues(i_async_event_queue* aQueues)
+    {
+        if (aQueues == nullptr)
+            return;
+        auto last = aQueues;
+        while (last->next_ready() != nullptr)
+            last = last->next_ready();
+        auto head = iReadyEventQueues.load(std::memory_order_relaxed);
+        do
+        {
+            last->set_next_ready(head);
+        } while (!iReadyEventQueues.compare_exchange_weak(head, aQueues, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void async_task::set_state(async_task_state aState)
+    {
+        // waiters check the state under the mutex so taking it here means a change cannot be missed
+        {
+            std::scoped_lock lock{ iStateMutex };
+            iState = aState;
+        }
+        iStateChanged.notify_all();
+    }
+
+    void async_task::wait_for_work()
+    {
+        if (have_message_queue())
+        {
+#ifdef _WIN32
+            // a native message queue can't be waited on alongside everything else so fall back to polling
+            this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+            return;
+#else
+            // posted messages wake() us
+            if (have_messages())
+                return;
+#endif
+        }
+        auto const deadline = iTimerService ? iTimerService->next_deadline() : std::nullopt;
+        if (deadline && *deadline <= std::chrono::steady_clock::now())
+            return;
+        iBlocked.store(true);
+        if (!iWakeRequested.exchange(false))
+        {
+            if (iIoService)
+                static_cast<neolib::io_service&>(*iIoService).wait(deadline);
+            else
+            {
+                std::unique_lock lock{ iWakeMutex };
+                auto const woken = [&]() { return iWakeRequested.load(); };
+                if (deadline)
+                    iWakeConditionVariable.wait_until(lock, *deadline, woken);
+                else
+                    iWakeConditionVariable.wait(lock, woken);
+            }
+        }
+        iBlocked.store(false);
+        iWakeSignalled.store(false);
+        iWakeRequested.store(false);
     }
 
     void async_task::idle()
@@ -0,0 +1,111 @@
+// coroutine.cpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <array>
+#include <new>
+#include <neolib/task/coroutine.hpp>
+
+namespace neolib
+{
+    namespace
+    {
+        struct free_frame
+        {
+            free_frame* next;
+        };
+
+        constexpr std::size_t kSizeClasses = coroutine_frame_pool::kMaxPooledFrameSize / coroutine_frame_pool::kGranularity;
+
+        std::size_t size_class(std::size_t aSize)
+        {
+            return (aSize + coroutine_frame_pool::kGranularity - 1) / coroutine_frame_pool::kGranularity - 1;
+        }
+
+        std::size_t class_size(std::size_t aSizeClass)
+        {
+            return (aSizeClass + 1) * coroutine_frame_pool::kGranularity;
+        }
+
+        // frames freed on a thread other than the allocating one simply join the freeing thread's cache
+        struct frame_cache
+        {
+            std::array<free_frame*, kSizeClasses> heads = {};
+            std::array<std::size_t, kSizeClasses> counts = {};
+
+            ~frame_cache()
+            {
+                for (std::size_t sizeClass = 0; sizeClass < kSizeClasses; ++sizeClass)
+                    while (heads[sizeClass] != nullptr)
+                        ::operator delete(std::exchange(heads[sizeClass], heads[sizeClass]->next));
+            }
+            static frame_cache& instance()
+            {
+                thread_local frame_cache tCache;
+                return tCache;
+            }
+        };
+    }
+
+    void* coroutine_frame_pool::allocate(std::size_t aSize)
+    {
+        if (aSize == 0 || aSize > kMaxPooledFrameSize)
+            return ::operator new(aSize);
+        auto const sizeClass = size_class(aSize);
+        auto& cache = frame_cache::instance();
+        if (cache.heads[sizeClass] == nullptr)
+            return ::operator new(class_size(sizeClass));
+        --cache.counts[sizeClass];
+        return std::exchange(cache.heads[sizeClass], cache.heads[sizeClass]->next);
+    }
+
+    void coroutine_frame_pool::deallocate(void* aFrame, std::size_t aSize) noexcept
+    {
+        if (aSize == 0 || aSize > kMaxPooledFrameSize)
+        {
+            ::operator delete(aFrame);
+            return;
+        }
+        auto const sizeClass = size_class(aSize);
+        auto& cache = frame_cache::instance();
+        if (cache.counts[sizeClass] >= kMaxCachedFramesPerSize)
+        {
+            ::operator delete(aFrame);
+            return;
+        }
+        ++cache.counts[sizeClass];
+        cache.heads[sizeClass] = new (aFrame) free_frame{ cache.heads[sizeClass] };
+    }
+}
@@ -34,6 +34,7 @@
  */
 
 #include <neolib/neolib.hpp>
+#include <bit>
 #include <unordered_map>
 #include <neolib/task/event.hpp>
 
@@ -64,8 +65,81 @@ namespace neolib
         throw std::logic_error("neolib::async_event_queue::instance: instance not found");
     }
 
-    async_event_queue::async_event_queue()
+    async_event_queue::entry_arena::entry_arena() :
+        iFree{ 0u },
+        iNextUnused{ 0u },
+        iChunks{}
     {
+    }
+
+    async_event_queue::entry_arena::~entry_arena()
+    {
+        for (auto& chunk : iChunks)
+            delete[] chunk.load(std::memory_order_relaxed);
+    }
+
+    async_event_queue::queue_entry& async_event_queue::entry_arena::allocate()
+    {
+        auto free = iFree.load(std::memory_order_acquire);
+        while ((free & 0xFFFFFFFFu) != 0u)
+        {
+            auto& entry = at(static_cast<std::uint32_t>(free & 0xFFFFFFFFu) - 1u);
+            // the tag makes the exchange fail if the entry has been taken and returned meanwhile
+            auto const next = ((free >> 32u) + 1u) << 32u | entry.nextFree.load(std::memory_order_relaxed);
+            if (iFree.compare_exchange_weak(free, next, std::memory_order_acq_rel, std::memory_order_acquire))
+                return entry;
+        }
+        return at(iNextUnused.fetch_add(1u, std::memory_order_relaxed));
+    }
+
+    void async_event_queue::entry_arena::deallocate(queue_entry& aEntry)
+    {
+        auto free = iFree.load(std::memory_order_relaxed);
+        std::uint64_t next;
+        do
+        {
+            aEntry.nextFree.store(static_cast<std::uint32_t>(free & 0xFFFFFFFFu), std::memory_order_relaxed);
+            next = ((free >> 32u) + 1u) << 32u | (aEntry.index + 1u);
+        } while (!iFree.compare_exchange_weak(free, next, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    async_event_queue::queue_entry& async_event_queue::entry_arena::at(std::uint32_t aIndex)
+    {
+        // chunk n holds (1 << (kFirstChunkBits + n)) entries so existing entries never move
+        auto const biased = static_cast<std::uint64_t>(aIndex) + (1u << kFirstChunkBits);
+        auto const msb = static_cast<std::uint32_t>(std::bit_width(biased) - 1u);
+        auto const chunkIndex = msb - kFirstChunkBits;
+        auto const offset = biased - (std::uint64_t{ 1u } << msb);
+        if (chunkIndex >= kMaxChunks)
+            throw std::bad_alloc();
+        auto chunk = iChunks[chunkIndex].load(std::memory_order_acquire);
+        if (chunk == nullptr)
+        {
+            auto const chunkSize = std::size_t{ 1u } << msb;
+            auto newChunk = new queue_entry[chunkSize];
+            for (std::size_t i = 0u; i < chunkSize; ++i)
+                newChunk[i].index = static_cast<std::uint32_t>((std::uint64_t{ 1u } << msb) - (1u << kFirstChunkBits) + i);
+            if (iChunks[chunkIndex].compare_exchange_strong(chunk, newChunk, std::memory_order_acq_rel, std::memory_order_acquire))
+                chunk = newChunk;
+            else
+                delete[] newChunk;
+        }
+        return chunk[offset];
+    }
+
+    std::shared_ptr<async_event_queue_handle> const& this_thread_event_queue()
+    {
+        return async_event_queue::instance().handle();
+    }
+
+    async_event_queue::async_event_queue() :
+        iHandle{ std::make_shared<async_event_queue_handle>(*this) },
+        iReady{ false },
+        iNextReady{ nullptr },
+        iTail{ &iStub },
+        iHead{ &iStub }
+    {
+        iStub.next.store(nullptr, std::memory_order_relaxed);
         std::scoped_lock lock{ event_mutex() };
         if (instance_map().find(std::this_thread::get_id()) == instance_map().end())
             instance_map()[std::this_thread::get_id()] = this;
@@ -73,12 +147,17 @@ namespace neolib
 
     async_event_queue::~async_event_queue()
     {
-        std::scoped_lock lock{ event_mutex() };
-        auto existing = instance_map().find(std::this_thread::get_id());
-        if (existing != instance_map().end())
-            instance_map().erase(existing);
-        if (iTask && !*iTaskDestroyed)
-            iTask->unregister_event_queue(*this);
+        iHandle->close();
+        {
+            std::scoped_lock lock{ event_mutex() };
+            auto existing = instance_map().find(std::this_thread::get_id());
+            if (existing != instance_map().end())
+                instance_map().erase(existing);
+            if (iTask && !*iTaskDestroyed)
+                iTask->unregister_event_queue(*this);
+        }
+        while (auto entry = pop())
+            release(*entry);
     }
 
     void async_event_queue::register_with_task(i_async_task& aTask)
@@ -86,32 +165,158 @@ namespace neolib
         iTask = &aTask;
         iTaskDestroyed.emplace(*iTask);
         iTask->register_event_queue(*this);
+        if (have_events())
+            ready();
+    }
+
+    bool async_event_queue::have_events() const
+    {
+        // lock-free but only exact on the consuming (owning) thread
+        return iHead != &iStub || iStub.next.load(std::memory_order_acquire) != nullptr || iTail.load(std::memory_order_acquire) != &iStub;
     }
 
     bool async_event_queue::pump_events()
     {
-        std::unique_lock lock{ event_mutex() };
         thread_local std::size_t stack;
         scoped_counter<std::size_t> stackCounter{ stack };
-        typedef std::vector<queue_entry> work_list;
+        typedef std::vector<queue_entry*> work_list;
         thread_local std::vector<std::unique_ptr<work_list>> workLists;
         if (workLists.size() < stack)
             workLists.push_back(std::make_unique<work_list>());
         auto& workList = *workLists[stack - 1];
-        workList.swap(iQueue.multiple);
-        for (auto const& se : iQueue.single)
-            workList.push_back(se.second);
-        iQueue.single.clear();
-        lock.unlock();
+        while (auto entry = pop())
+            workList.push_back(entry);
+        event_tracing::pump_trace<> trace;
         bool didSome = false;
-        for (auto& entry : workList)
+        std::size_t next = 0u;
+        try
+        {
+            while (next < workList.size())
+            {
+                auto& entry = *workList[next++];
+                // a later call queued to a slot not accepting duplicates supersedes this one
+                if (entry.slot->connected() && (entry.sequence == 0u || entry.sequence == entry.slot->enqueue_sequence()))
+                {
+                    didSome = true;
+                    trace.call_made();
+                    entry.invoke(entry);
+                }
+                release(entry);
+            }
+        }
+        catch (...)
         {
-            if (entry.eventDestroyed || entry.slotDestroyed)
-                continue;
-            entry.callback();
-            didSome = true;
+            release(*workList[next - 1u]);
+            while (next < workList.size())
+                release(*workList[next++]);
+            workList.clear();
+            throw;
         }
         workList.clear();
         return didSome;
     }
+
+    void async_event_queue::enqueue_delivery(i_slot_base& aSlot)
+    {
+        auto& entry = iArena.allocate();
+        aSlot.add_ref();
+        entry.slot = &aSlot;
+        entry.sequence = 0u;
+        entry.invoke = [](queue_entry& aEntry) { aEntry.slot->deliver(); };
+        entry.destroy = [](queue_entry&) {};
+        push(entry);
+        ready();
+    }
+
+    i_async_event_queue* async_event_queue::next_ready() const
+    {
+        return iNextReady;
+    }
+
+    void async_event_queue::set_next_ready(i_async_event_queue* aNext)
+    {
+        iNextReady = aNext;
+    }
+
+    void async_event_queue::reset_ready()
+    {
+        // an RMW so that an enqueue which saw the queue ready has its entry visible to the pump that follows
+        iReady.exchange(false, std::memory_order_acq_rel);
+    }
+
+    std::shared_ptr<async_event_queue_handle> const& async_event_queue::handle() const
+    {
+        return iHandle;
+    }
+
+    bool async_event_queue_handle::enqueue_delivery(i_slot_base& aSlot)
+    {
+        iUsers.fetch_add(1u);
+        auto const queue = iQueue.load();
+        try
+        {
+            if (queue != nullptr)
+                queue->enqueue_delivery(aSlot);
+        }
+        catch (...)
+        {
+            iUsers.fetch_sub(1u);
+            throw;
+        }
+        iUsers.fetch_sub(1u);
+        return queue != nullptr;
+    }
+
+    void async_event_queue::push(queue_entry& aEntry)
+    {
+        aEntry.next.store(nullptr, std::memory_order_relaxed);
+        auto const previous = iTail.exchange(&aEntry, std::memory_order_acq_rel);
+        previous->next.store(&aEntry, std::memory_order_release);
+    }
+
+    async_event_queue::queue_entry* async_event_queue::pop()
+    {
+        auto head = iHead;
+        auto next = head->next.load(std::memory_order_acquire);
+        if (head == &iStub)
+        {
+            if (next == nullptr)
+                return nullptr;
+            iHead = next;
+            head = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr)
+        {
+            iHead = next;
+            return head;
+        }
+        // a producer that has swapped the tail but not yet linked its entry will wake us again
+        if (head != iTail.load(std::memory_order_acquire))
+            return nullptr;
+        push(iStub);
+        next = head->next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            iHead = next;
+            return head;
+        }
+        return nullptr;
+    }
+
+    void async_event_queue::ready()
+    {
+        // called after the entry is linked: a producer still linking when the queue is pumped will make it ready again
+        if (iTask != nullptr && !*iTaskDestroyed && !iReady.exchange(true, std::memory_order_acq_rel))
+            iTask->event_queue_ready(*this);
+    }
+
+    void async_event_queue::release(queue_entry& aEntry)
+    {
+        aEntry.destroy(aEntry);
+        auto const slot = aEntry.slot;
+        aEntry.slot = nullptr;
+        iArena.deallocate(aEntry);
+        slot->release();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+// event_tracing.cpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <mutex>
+#include <vector>
+#include <neolib/task/event_tracing.hpp>
+
+namespace neolib
+{
+    namespace event_tracing
+    {
+        namespace
+        {
+            struct thread_statistics;
+
+            struct registry
+            {
+                std::mutex mutex;
+                std::vector<thread_statistics*> threads;
+                // statistics of threads that have exited
+                event_statistics_map retiredEvents;
+                queue_statistics retiredQueues;
+            };
+
+            registry& the_registry()
+            {
+                static registry sRegistry;
+                return sRegistry;
+            }
+
+            void merge(event_statistics_map& aTo, event_statistics_map const& aFrom)
+            {
+                for (auto const& [event, from] : aFrom)
+                {
+                    auto& to = aTo[event];
+                    to.syncTriggers += from.syncTriggers;
+                    to.asyncTriggers += from.asyncTriggers;
+                    to.slotCalls += from.slotCalls;
+                    to.queuedCalls += from.queuedCalls;
+                    to.dispatchTime += from.dispatchTime;
+                }
+            }
+
+            void merge(queue_statistics& aTo, queue_statistics const& aFrom)
+            {
+                aTo.pumps += aFrom.pumps;
+                aTo.calls += aFrom.calls;
+                aTo.dispatchTime += aFrom.dispatchTime;
+            }
+
+            // only contended when a snapshot is taken
+            struct thread_statistics
+            {
+                std::mutex mutex;
+                event_statistics_map events;
+                queue_statistics queues;
+
+                thread_statistics()
+                {
+                    auto& r = the_registry();
+                    std::scoped_lock lock{ r.mutex };
+                    r.threads.push_back(this);
+                }
+                ~thread_statistics()
+                {
+                    auto& r = the_registry();
+                    std::scoped_lock lock{ r.mutex };
+                    merge(r.retiredEvents, events);
+                    merge(r.retiredQueues, queues);
+                    std::erase(r.threads, this);
+                }
+            };
+
+            thread_statistics& this_thread_statistics()
+            {
+                thread_local thread_statistics tStatistics;
+                return tStatistics;
+            }
+        }
+
+        void record_trigger(void const* aEvent, bool aAsync, std::uint64_t aSlotCalls, std::uint64_t aQueuedCalls, std::chrono::nanoseconds aDispatchTime)
+        {
+            auto& statistics = this_thread_statistics();
+            std::scoped_lock lock{ statistics.mutex };
+            auto& event = statistics.events[aEvent];
+            ++(aAsync ? event.asyncTriggers : event.syncTriggers);
+            event.slotCalls += aSlotCalls;
+            event.queuedCalls += aQueuedCalls;
+            event.dispatchTime += aDispatchTime;
+        }
+
+        void record_pump(std::uint64_t aCalls, std::chrono::nanoseconds aDispatchTime)
+        {
+            auto& statistics = this_thread_statistics();
+            std::scoped_lock lock{ statistics.mutex };
+            ++statistics.queues.pumps;
+            statistics.queues.calls += aCalls;
+            statistics.queues.dispatchTime += aDispatchTime;
+        }
+
+        event_statistics_map event_snapshot()
+        {
+            auto& r = the_registry();
+            std::scoped_lock lock{ r.mutex };
+            event_statistics_map result = r.retiredEvents;
+            for (auto statistics : r.threads)
+            {
+                std::scoped_lock threadLock{ statistics->mutex };
+                merge(result, statistics->events);
+            }
+            return result;
+        }
+
+        queue_statistics queue_snapshot()
+        {
+            auto& r = the_registry();
+            std::scoped_lock lock{ r.mutex };
+            queue_statistics result = r.retiredQueues;
+            for (auto statistics : r.threads)
+            {
+                std::scoped_lock threadLock{ statistics->mutex };
+                merge(result, statistics->queues);
+            }
+            return result;
+        }
+
+        void reset()
+        {
+            auto& r = the_registry();
+            std::scoped_lock lock{ r.mutex };
+            r.retiredEvents.clear();
+            r.retiredQueues = {};
+            for (auto statistics : r.threads)
+            {
+                std::scoped_lock threadLock{ statistics->mutex };
+                statistics->events.clear();
+                statistics->queues = {};
+            }
+        }
+    }
+}
@@ -0,0 +1,174 @@
+// task_graph.cpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <neolib/neolib.hpp>
+#include <neolib/task/task_graph.hpp>
+
+namespace neolib
+{
+    task_graph::task_graph(thread_pool& aThreadPool) :
+        iThreadPool{ aThreadPool }, iValidated{ true }, iRunning{ false }, iFailed{ false }, iGroup{ aThreadPool }
+    {
+    }
+
+    task_graph::~task_graph()
+    {
+    }
+
+    thread_pool& task_graph::pool() const
+    {
+        return iThreadPool;
+    }
+
+    std::size_t task_graph::node_count() const
+    {
+        return iNodes.size();
+    }
+
+    task_graph::node_id task_graph::add_node(std::function<void()> aWork, int32_t aPriority)
+    {
+        if (running())
+            throw graph_running();
+        auto& newNode = iNodes.emplace_back();
+        newNode.work = std::move(aWork);
+        newNode.priority = aPriority;
+        newNode.predecessors = 0;
+        newNode.pending = 0;
+        iValidated = false;
+        return iNodes.size() - 1;
+    }
+
+    void task_graph::add_edge(node_id aFrom, node_id aTo)
+    {
+        if (running())
+            throw graph_running();
+        if (aFrom >= iNodes.size() || aTo >= iNodes.size())
+            throw node_not_found();
+        if (aFrom == aTo)
+            throw cycle_detected();
+        iNodes[aFrom].successors.push_back(aTo);
+        ++iNodes[aTo].predecessors;
+        iValidated = false;
+    }
+
+    void task_graph::clear()
+    {
+        if (running())
+            throw graph_running();
+        iNodes.clear();
+        iRoots.clear();
+        iValidated = true;
+    }
+
+    void task_graph::run()
+    {
+        if (iRunning.exchange(true))
+            throw graph_running();
+        struct reset_running
+        {
+            std::atomic<bool>& running;
+            ~reset_running() { running = false; }
+        } resetRunning{ iRunning };
+        if (!iValidated)
+            validate();
+        if (iNodes.empty())
+            return;
+        for (auto& n : iNodes)
+            n.pending.store(n.predecessors, std::memory_order_relaxed);
+        iFailed = false;
+        for (auto root : iRoots)
+            iGroup.run([this, root]() { execute(root); }, iNodes[root].priority);
+        iGroup.wait();
+    }
+
+    bool task_graph::running() const
+    {
+        return iRunning;
+    }
+
+    void task_graph::validate()
+    {
+        // Kahn's algorithm: every node must be reachable from a root via completed predecessors
+        iRoots.clear();
+        std::vector<std::size_t> remaining;
+        remaining.reserve(iNodes.size());
+        std::vector<node_id> ready;
+        for (node_id id = 0; id < iNodes.size(); ++id)
+        {
+            remaining.push_back(iNodes[id].predecessors);
+            if (iNodes[id].predecessors == 0)
+            {
+                iRoots.push_back(id);
+                ready.push_back(id);
+            }
+        }
+        std::size_t visited = 0;
+        while (!ready.empty())
+        {
+            auto const id = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (auto successor : iNodes[id].successors)
+                if (--remaining[successor] == 0)
+                    ready.push_back(successor);
+        }
+        if (visited != iNodes.size())
+            throw cycle_detected();
+        iValidated = true;
+    }
+
+    void task_graph::execute(node_id aNode)
+    {
+        auto& n = iNodes[aNode];
+        std::exception_ptr exception;
+        if (!iFailed.load(std::memory_order_relaxed))
+        {
+            try
+            {
+                n.work();
+            }
+            catch (...)
+            {
+                iFailed = true;
+                exception = std::current_exception();
+            }
+        }
+        for (auto successor : n.successors)
+            if (iNodes[successor].pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                iGroup.run([this, successor]() { execute(successor); }, iNodes[successor].priority);
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+}
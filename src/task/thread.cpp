@@ -38,11 +38,42 @@
 #include <chrono>
 #include <functional>
 #include <boost/chrono/thread_clock.hpp>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 #include <neolib/core/singleton.hpp>
 #include <neolib/task/thread.hpp>
 
 namespace neolib
 {
+    namespace
+    {
+        template <typename NativeHandle>
+        bool set_native_affinity(NativeHandle aThread, cpu_list const& aCpus)
+        {
+            auto const& cpus = aCpus.empty() ? all_cpus() : aCpus;
+#if defined(__linux__)
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            for (auto cpu : cpus)
+                if (cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &cpuSet);
+            return ::pthread_setaffinity_np(aThread, sizeof(cpuSet), &cpuSet) == 0;
+#elif defined(_WIN32)
+            DWORD_PTR mask = 0;
+            for (auto cpu : cpus)
+                if (cpu < sizeof(mask) * 8)
+                    mask |= (static_cast<DWORD_PTR>(1) << cpu);
+            return ::SetThreadAffinityMask(aThread, mask) != 0;
+#else
+            (void)aThread;
+            (void)cpus;
+            return false;
+#endif
+        }
+    }
+
     namespace this_thread
     {
         template<class Rep, class Period>
@@ -78,6 +109,42 @@ namespace neolib
         {
             return elapsed_us() / 1000;
         }
+
+        std::optional<cpu_id> current_cpu() noexcept
+        {
+#if defined(__linux__)
+            auto const cpu = ::sched_getcpu();
+            if (cpu >= 0)
+                return static_cast<cpu_id>(cpu);
+#elif defined(_WIN32)
+            return static_cast<cpu_id>(::GetCurrentProcessorNumber());
+#endif
+            return {};
+        }
+
+        bool set_affinity(cpu_list const& aCpus)
+        {
+#if defined(__linux__)
+            return set_native_affinity(::pthread_self(), aCpus);
+#elif defined(_WIN32)
+            return set_native_affinity(::GetCurrentThread(), aCpus);
+#else
+            return set_native_affinity(nullptr, aCpus);
+#endif
+        }
+
+        void set_name(std::string const& aName)
+        {
+#if defined(__linux__)
+            // native thread names are limited to 15 characters so drop the namespace qualification of
+            // the leading identifier (e.g. "neolib::ecs Physics" becomes "ecs Physics")
+            auto const qualifier = aName.rfind("::", aName.find(' '));
+            auto const unqualified = qualifier == std::string::npos ? aName : aName.substr(qualifier + 2);
+            ::pthread_setname_np(::pthread_self(), unqualified.substr(0, 15).c_str());
+#else
+            (void)aName;
+#endif
+        }
     }
 
     namespace this_process
@@ -196,7 +263,10 @@ namespace neolib
             canCancel = true;
         }
         if (canCancel)
+        {
+            iWaiters.notify();
             throw cancellation();
+        }
     }
 
     void thread::abort(bool aWait)
@@ -221,6 +291,7 @@ namespace neolib
         if (aWait && aborted())
             wait();
         iState = thread_state::Finished;
+        iWaiters.notify();
     }
 
     void thread::wait() const
@@ -248,13 +319,17 @@ namespace neolib
             throw thread_not_started();
         if (in())
             throw cannot_wait_on_self();
+        scoped_waiter w{ {}, &aMessageQueue, this };
         for(;;)
         {
             if (waitable_ready())
                 return true;
             if (aMessageQueue.have_message())
                 return false;
-            this_thread::yield();
+            if (w.poll())
+                w.wait(std::chrono::steady_clock::now() + std::chrono::milliseconds{ 1 });
+            else
+                w.wait();
         }
     }
 
@@ -359,9 +434,39 @@ namespace neolib
         return *iThreadObject; 
     }
 
+    std::optional<cpu_list> thread::affinity() const
+    {
+        std::scoped_lock<std::recursive_mutex> lock{ iMutex };
+        return iAffinity;
+    }
+
+    bool thread::set_affinity(cpu_list const& aCpus)
+    {
+        std::scoped_lock<std::recursive_mutex> lock{ iMutex };
+        iAffinity = aCpus;
+        if (!running())
+            return true; // applied when the thread starts
+        if (std::this_thread::get_id() == iId)
+            return this_thread::set_affinity(aCpus);
+        if (has_thread_object())
+            return set_native_affinity(thread_object().native_handle(), aCpus);
+        return false;
+    }
+
     bool thread::waitable_ready() const noexcept
     {
-        return thread_object().get_id() == std::thread::id();
+        return finished();
+    }
+
+    bool thread::add_waiter(waiter& aWaiter) const
+    {
+        iWaiters.add(aWaiter);
+        return true;
+    }
+
+    void thread::remove_waiter(waiter& aWaiter) const
+    {
+        iWaiters.remove(aWaiter);
     }
 
     void thread::exec_preamble()
@@ -384,6 +489,10 @@ namespace neolib
                 return;
             iState = thread_state::Started;
             iId = std::this_thread::get_id();
+            if (!iName.empty() && !iUsingExistingThread)
+                this_thread::set_name(iName);
+            if (iAffinity)
+                this_thread::set_affinity(*iAffinity);
         }
         try
         {
@@ -395,6 +504,7 @@ namespace neolib
                 if (iState == thread_state::Started)
                     iState = thread_state::Finished;
             }
+            iWaiters.notify();
         }
         catch(const std::exception& aException)
         {
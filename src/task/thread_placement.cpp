@@ -0,0 +1,163 @@
+// thread_placement.cpp
+/*
+ *  Copyright (c) 2026 Leigh Johnston.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *     * Neither the name of Leigh Johnston nor the names of any
+ *       other contributors to this software may be used to endorse or
+ *       promote products derived from this software without specific prior
+ *       written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ *  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ *  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ *  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <neolib/neolib.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <neolib/task/thread_placement.hpp>
+
+namespace neolib
+{
+    namespace
+    {
+#ifdef __linux__
+        // parse a sysfs CPU list such as "0-7,16-23"
+        cpu_list parse_cpu_list(std::string const& aList)
+        {
+            cpu_list result;
+            std::size_t position = 0;
+            while (position < aList.size())
+            {
+                auto const end = std::min(aList.find(',', position), aList.size());
+                auto const range = aList.substr(position, end - position);
+                auto const dash = range.find('-');
+                try
+                {
+                    auto const first = static_cast<cpu_id>(std::stoul(range.substr(0, dash)));
+                    auto const last = dash == std::string::npos ? first : static_cast<cpu_id>(std::stoul(range.substr(dash + 1)));
+                    for (auto cpu = first; cpu <= last; ++cpu)
+                        result.push_back(cpu);
+                }
+                catch (...)
+                {
+                }
+                position = end + 1;
+            }
+            return result;
+        }
+
+        std::optional<cpu_list> read_numa_node_cpus(std::uint32_t aNode)
+        {
+            std::ifstream cpuList{ "/sys/devices/system/node/node" + std::to_string(aNode) + "/cpulist" };
+            std::string list;
+            if (!cpuList || !std::getline(cpuList, list))
+                return {};
+            return parse_cpu_list(list);
+        }
+#endif
+    }
+
+    std::uint32_t cpu_count()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    cpu_list all_cpus()
+    {
+        cpu_list result(cpu_count());
+        for (cpu_id cpu = 0; cpu < result.size(); ++cpu)
+            result[cpu] = cpu;
+        return result;
+    }
+
+    std::uint32_t numa_node_count()
+    {
+#if defined(__linux__)
+        std::uint32_t result = 0;
+        while (std::filesystem::exists("/sys/devices/system/node/node" + std::to_string(result)))
+            ++result;
+        return std::max(1u, result);
+#elif defined(_WIN32)
+        ULONG highestNode = 0;
+        if (!::GetNumaHighestNodeNumber(&highestNode))
+            return 1;
+        return static_cast<std::uint32_t>(highestNode + 1);
+#else
+        return 1;
+#endif
+    }
+
+    cpu_list numa_node_cpus(std::uint32_t aNode)
+    {
+#if defined(__linux__)
+        auto const cpus = read_numa_node_cpus(aNode);
+        if (cpus)
+            return *cpus;
+#elif defined(_WIN32)
+        ULONGLONG mask = 0;
+        if (::GetNumaNodeProcessorMask(static_cast<UCHAR>(aNode), &mask))
+        {
+            cpu_list result;
+            for (cpu_id cpu = 0; cpu < 64; ++cpu)
+                if (mask & (1ull << cpu))
+                    result.push_back(cpu);
+            return result;
+        }
+#endif
+        return aNode == 0 ? all_cpus() : cpu_list{};
+    }
+
+    std::optional<std::uint32_t> numa_node_of_cpu(cpu_id aCpu)
+    {
+        for (std::uint32_t node = 0; node < numa_node_count(); ++node)
+        {
+            auto const cpus = numa_node_cpus(node);
+            if (std::find(cpus.begin(), cpus.end(), aCpu) != cpus.end())
+                return node;
+        }
+        return {};
+    }
+
+    thread_placement thread_placement::excluding(cpu_list const& aReservedCpus) const
+    {
+        thread_placement result{ cpus.empty() ? all_cpus() : cpus, pinned };
+        result.cpus.erase(std::remove_if(result.cpus.begin(), result.cpus.end(), 
+            [&](cpu_id aCpu) { return std::find(aReservedCpus.begin(), aReservedCpus.end(), aCpu) != aReservedCpus.end(); }), result.cpus.end());
+        if (result.cpus.empty())
+            return *this; // nothing would be left so don't restrict further
+        return result;
+    }
+
+    cpu_list thread_placement::affinity(std::size_t aThreadIndex) const
+    {
+        if (cpus.empty() || !pinned)
+            return cpus;
+        return { cpus[aThreadIndex % cpus.size()] };
+    }
+}
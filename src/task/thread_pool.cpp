@@ -34,139 +34,367 @@
 */
 
 #include <neolib/neolib.hpp>
+#include <algorithm>
+#include <bit>
 #include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
 #include <neolib/core/scoped.hpp>
 #include <neolib/core/lifetime.hpp>
 #include <neolib/task/thread.hpp>
+#include <neolib/task/work_stealing_deque.hpp>
 #include <neolib/task/thread_pool.hpp>
 
 namespace neolib
 {
-    class thread_pool_thread : public thread
+    namespace
     {
-    public:
-        typedef std::shared_ptr<i_task> task_pointer;
-        typedef std::pair<task_pointer, int32_t> task_queue_entry;
-        typedef std::deque<task_queue_entry> task_queue;
-    public:
-        struct no_active_task : std::logic_error { no_active_task() : std::logic_error("neolib::thread_pool_thread::no_active_task") {} };
-        struct already_active : std::logic_error { already_active() : std::logic_error("neolib::thread_pool_thread::already_active") {} };
-    public:
-        thread_pool_thread(thread_pool& aThreadPool) : thread{ "neolib::thread_pool_thread" }, iThreadPool{ aThreadPool }, iPoolMutex{ aThreadPool.mutex() }, iStopped{ false }
+        thread_local thread_pool_thread* tCurrentThread;
+
+        constexpr std::chrono::steady_clock::rep kNoDeadline = std::numeric_limits<std::chrono::steady_clock::rep>::max();
+
+        // timer heap ordering (earliest deadline at the front, FIFO among equal deadlines)
+        constexpr auto later_timer = [](auto const& aLeft, auto const& aRight)
         {
-            start();
+            return aLeft.due > aRight.due || (aLeft.due == aRight.due && aLeft.sequence > aRight.sequence);
+        };
+
+        std::size_t random_victim(std::size_t aThreadCount)
+        {
+            // xorshift32
+            thread_local std::uint32_t tState = static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+            tState ^= tState << 13;
+            tState ^= tState >> 17;
+            tState ^= tState << 5;
+            return tState % aThreadCount;
         }
-        ~thread_pool_thread()
+
+        // Per-thread free list of queue entries. Entries are usually allocated on one thread (the
+        // submitter) and freed on another (the worker) so surplus entries are handed back in batches
+        // through a shared depot rather than one at a time.
+        constexpr std::size_t kEntryBatchSize = 64;
+        constexpr std::size_t kMaxCachedEntries = kEntryBatchSize * 4;
+        constexpr std::size_t kMaxDepotBatches = 256;
+
+        template <typename Entry>
+        void delete_entries(Entry* aHead)
         {
+            while (aHead != nullptr)
+                delete std::exchange(aHead, aHead->next);
         }
-    public:
-        virtual void exec(yield_type aYieldType = yield_type::NoYield)
+
+        template <typename Entry>
+        struct entry_depot
         {
-            while (!finished())
+            struct batch
             {
-                std::unique_lock<std::mutex> lk(iCondVarMutex);
-                iConditionVariable.wait(lk, [this] { return iActiveTask != nullptr || iStopped; });
-                lk.unlock();
-                if (iStopped)
+                Entry* head;
+                std::size_t count;
+            };
+            std::mutex mutex;
+            std::vector<batch> batches;
+
+            static entry_depot& instance()
+            {
+                // intentionally never destroyed as pool threads may still be running during static destruction
+                static entry_depot* const sDepot = new entry_depot{};
+                return *sDepot;
+            }
+        };
+
+        template <typename Entry>
+        struct entry_cache
+        {
+            typedef entry_depot<Entry> depot;
+
+            Entry* head = nullptr;
+            std::size_t count = 0;
+
+            ~entry_cache()
+            {
+                delete_entries(head);
+            }
+            Entry* allocate()
+            {
+                if (head == nullptr)
+                {
+                    auto& d = depot::instance();
+                    std::scoped_lock<std::mutex> lk{ d.mutex };
+                    if (!d.batches.empty())
+                    {
+                        head = d.batches.back().head;
+                        count = d.batches.back().count;
+                        d.batches.pop_back();
+                    }
+                }
+                if (head == nullptr)
+                    return new Entry{};
+                --count;
+                return std::exchange(head, head->next);
+            }
+            void free(Entry* aEntry)
+            {
+                aEntry->next = head;
+                head = aEntry;
+                if (++count < kMaxCachedEntries)
                     return;
-                if (!iActiveTask->cancelled())
-                    iActiveTask->run(aYieldType);
-                std::scoped_lock<std::recursive_mutex> lk2(iPoolMutex);
-                release();
-                next_task();
+                typename depot::batch surplus{ head, kEntryBatchSize };
+                auto last = head;
+                for (std::size_t i = 1; i < kEntryBatchSize; ++i)
+                    last = last->next;
+                head = std::exchange(last->next, nullptr);
+                count -= kEntryBatchSize;
+                auto& d = depot::instance();
+                std::unique_lock<std::mutex> lk{ d.mutex };
+                if (d.batches.size() < kMaxDepotBatches)
+                    d.batches.push_back(surplus);
+                else
+                {
+                    lk.unlock();
+                    delete_entries(surplus.head);
+                }
+            }
+
+            static entry_cache& instance()
+            {
+                thread_local entry_cache tCache;
+                return tCache;
             }
+        };
+    }
+
+    struct thread_pool::priority_level
+    {
+        static constexpr std::size_t kUnlimited = std::numeric_limits<std::size_t>::max();
+
+        int32_t priority;
+        std::deque<task_queue_entry*> queue;
+        std::atomic<std::size_t> concurrencyLimit;
+        std::atomic<std::size_t> running;
+
+        priority_level(int32_t aPriority) :
+            priority{ aPriority }, concurrencyLimit{ kUnlimited }, running{ 0 }
+        {
+        }
+        bool throttled() const
+        {
+            return running >= concurrencyLimit;
         }
+    };
+
+    class thread_pool::scheduled_task : public task<>, public std::enable_shared_from_this<scheduled_task>
+    {
     public:
-        bool active() const
+        scheduled_task(thread_pool& aThreadPool, std::function<void()> aFunction, int32_t aPriority, 
+            std::optional<std::chrono::steady_clock::duration> const& aPeriod = {}) :
+            iThreadPool{ aThreadPool }, iFunction{ std::move(aFunction) }, iPriority{ aPriority }, iPeriod{ aPeriod }
         {
-            std::scoped_lock<std::mutex> lk(iCondVarMutex);
-            return iActiveTask != nullptr;
         }
-        bool idle() const
+    public:
+        const std::string& name() const override
+        {
+            static const std::string sName = "neolib::thread_pool::scheduled_task";
+            return sName;
+        }
+        void run(yield_type) override
+        {
+            iFunction();
+            // periodic tasks are rescheduled on completion so runs never overlap; a run that overruns 
+            // its period delays the next run rather than causing a burst of catch up runs
+            if (iPeriod && !cancelled())
+                iThreadPool.schedule(shared_from_this(), std::max(iDue + *iPeriod, std::chrono::steady_clock::now()));
+        }
+    public:
+        int32_t priority() const
+        {
+            return iPriority;
+        }
+        void set_due(std::chrono::steady_clock::time_point aDue)
+        {
+            iDue = aDue;
+        }
+    private:
+        thread_pool& iThreadPool;
+        std::function<void()> iFunction;
+        int32_t iPriority;
+        std::optional<std::chrono::steady_clock::duration> iPeriod;
+        std::chrono::steady_clock::time_point iDue;
+    };
+
+    struct alignas(BOOST_LOCKFREE_CACHELINE_BYTES) thread_pool::worker_counters
+    {
+        typedef std::array<std::atomic<std::uint64_t>, statistics::kHistogramBuckets> histogram;
+
+        std::atomic<std::uint64_t> tasksExecuted = 0;
+        std::atomic<std::uint64_t> stealAttempts = 0;
+        std::atomic<std::uint64_t> steals = 0;
+        histogram startLatency = {};
+        histogram runTime = {};
+
+        static void increment(std::atomic<std::uint64_t>& aCounter, std::uint64_t aAmount = 1)
+        {
+            aCounter.fetch_add(aAmount, std::memory_order_relaxed);
+        }
+        static void record(histogram& aHistogram, std::chrono::steady_clock::duration aDuration)
         {
-            std::scoped_lock<std::recursive_mutex> lk(iPoolMutex);
-            std::scoped_lock<std::mutex> lk2(iCondVarMutex);
-            return iActiveTask == nullptr && iWaitingTasks.empty();
+            auto const ns = static_cast<std::uint64_t>(std::max<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(aDuration).count(), 1));
+            auto const bucket = std::min<std::size_t>(std::bit_width(ns) - 1, statistics::kHistogramBuckets - 1);
+            increment(aHistogram[bucket]);
         }
-        void add(task_pointer aTask, int32_t aPriority)
+        void accumulate(statistics& aStatistics) const
         {
-            std::scoped_lock<std::recursive_mutex> lk(iPoolMutex);
-            auto where = std::upper_bound(iWaitingTasks.begin(), iWaitingTasks.end(), task_queue_entry{ task_pointer{}, aPriority },
-                [](const task_queue_entry& aLeft, const task_queue_entry& aRight)
+            aStatistics.tasksExecuted += tasksExecuted.load(std::memory_order_relaxed);
+            aStatistics.stealAttempts += stealAttempts.load(std::memory_order_relaxed);
+            aStatistics.steals += steals.load(std::memory_order_relaxed);
+            for (std::size_t bucket = 0; bucket < statistics::kHistogramBuckets; ++bucket)
             {
-                return aLeft.second > aRight.second;
-            });
-            iWaitingTasks.emplace(where, aTask, aPriority);
-            if (!active())
-                next_task();
+                aStatistics.startLatency[bucket] += startLatency[bucket].load(std::memory_order_relaxed);
+                aStatistics.runTime[bucket] += runTime[bucket].load(std::memory_order_relaxed);
+            }
         }
-        bool steal_work(thread_pool_thread& aIdleThread)
+        void merge(worker_counters const& aOther)
         {
-            std::unique_lock<std::recursive_mutex> lk(iPoolMutex);
-            if (!iWaitingTasks.empty())
+            increment(tasksExecuted, aOther.tasksExecuted.load(std::memory_order_relaxed));
+            increment(stealAttempts, aOther.stealAttempts.load(std::memory_order_relaxed));
+            increment(steals, aOther.steals.load(std::memory_order_relaxed));
+            for (std::size_t bucket = 0; bucket < statistics::kHistogramBuckets; ++bucket)
             {
-                auto newTask = iWaitingTasks.front();
-                iWaitingTasks.pop_front();
-                aIdleThread.add(newTask.first, newTask.second);
-                return true;
+                increment(startLatency[bucket], aOther.startLatency[bucket].load(std::memory_order_relaxed));
+                increment(runTime[bucket], aOther.runTime[bucket].load(std::memory_order_relaxed));
             }
-            return false;
         }
-        void stop()
+        void reset()
         {
-            if (!iStopped)
+            tasksExecuted = 0;
+            stealAttempts = 0;
+            steals = 0;
+            for (std::size_t bucket = 0; bucket < statistics::kHistogramBuckets; ++bucket)
             {
-                {
-                    std::scoped_lock<std::mutex> lk2(iCondVarMutex);
-                    iStopped = true;
-                }
-                iConditionVariable.notify_one();
-                wait();
+                startLatency[bucket] = 0;
+                runTime[bucket] = 0;
             }
         }
-    private:
-        void next_task()
-        {
-            std::unique_lock<std::recursive_mutex> lk(iPoolMutex);
-            if (active())
-                throw already_active();
-            if (iWaitingTasks.empty())
-                iThreadPool.steal_work(*this);
-            if (!iWaitingTasks.empty())
+    };
+
+    class thread_pool_thread : public thread
+    {
+    public:
+        typedef thread_pool::task_queue_entry task_queue_entry;
+        typedef work_stealing_deque<task_queue_entry*> task_queue;
+    public:
+        thread_pool_thread(thread_pool& aThreadPool, std::size_t aIndex, std::size_t aSerial) : 
+            thread{ "neolib::thread_pool #" + std::to_string(aSerial) }, 
+            iThreadPool{ aThreadPool }, 
+            iIndex{ aIndex }, 
+            iActive{ false },
+            iStopped{ false }
+        {
+            start();
+        }
+        ~thread_pool_thread()
+        {
+        }
+    public:
+        virtual void exec(yield_type aYieldType = yield_type::NoYield)
+        {
+            tCurrentThread = this;
+            while (!iStopped)
             {
+                auto const workGeneration = iThreadPool.iWorkGeneration.load();
+                auto entry = iThreadPool.next_task(this);
+                if (entry == nullptr)
                 {
-                    std::scoped_lock<std::mutex> lk2(iCondVarMutex);
-                    iActiveTask = iWaitingTasks.front().first;
-                    iWaitingTasks.pop_front();
+                    if (!iThreadPool.park(*this, workGeneration) && iThreadPool.retire(*this))
+                        return;
+                    continue;
                 }
-                iConditionVariable.notify_one();
-                iThreadPool.thread_gone_busy();
+                iActive = true;
+                ++iThreadPool.iActiveThreads;
+                iThreadPool.execute(entry, aYieldType);
+                --iThreadPool.iActiveThreads;
+                iActive = false;
             }
-            else
-                iThreadPool.thread_gone_idle();
         }
-        void release()
+    public:
+        thread_pool& pool() const
+        {
+            return iThreadPool;
+        }
+        // the lowest index not used by another live thread of the pool so placement fills the CPUs retired threads left idle
+        std::size_t index() const
         {
-            task_pointer currentTask;
+            return iIndex;
+        }
+        task_queue& queue()
+        {
+            return iQueue;
+        }
+        thread_pool::worker_counters& counters()
+        {
+            return iCounters;
+        }
+        bool active() const
+        {
+            return iActive;
+        }
+        bool idle() const
+        {
+            return !iActive && iQueue.empty();
+        }
+        bool stopping() const
+        {
+            return iStopped;
+        }
+        void stop()
+        {
+            if (!iStopped)
             {
-                std::scoped_lock<std::mutex> lk(iCondVarMutex);
-                if (iActiveTask == nullptr)
-                    throw no_active_task();
-                currentTask = iActiveTask;
-                iActiveTask = nullptr;
+                {
+                    std::scoped_lock<std::mutex> lk{ iThreadPool.iParkMutex };
+                    iStopped = true;
+                }
+                iThreadPool.iParkConditionVariable.notify_all();
+                iThreadPool.iTimerConditionVariable.notify_all();
+                wait();
             }
         }
     private:
         thread_pool& iThreadPool;
-        std::recursive_mutex& iPoolMutex;
-        mutable std::mutex iCondVarMutex;
-        std::condition_variable iConditionVariable;
-        task_queue iWaitingTasks;
-        task_pointer iActiveTask;
+        std::size_t const iIndex;
+        task_queue iQueue;
+        thread_pool::worker_counters iCounters;
+        std::atomic<bool> iActive;
         std::atomic<bool> iStopped;
     };
 
-    thread_pool::thread_pool() : iIdle{ true }, iStopped { false }, iMaxThreads{ 0 }
+    thread_pool::thread_pool() : 
+        iStopped{ false }, 
+        iMaxThreads{ 0 },
+        iThreadCount{ 0 },
+        iNextThreadIndex{ 0 },
+        iNextThreadSerial{ 0 },
+        iElastic{ false },
+        iGrowing{ false },
+        iIdleTimeout{ 0 },
+        iGrowthDelay{ 0 },
+        iGrowthQueueDepth{ 0 },
+        iBacklogSince{ 0 },
+        iNonEmptyLevels{ 0 },
+        iDefaultPriorityLimited{ false },
+        iInjectionQueueSize{ 0 },
+        iWorkGeneration{ 0 },
+        iQueuedTasks{ 0 },
+        iPendingTasks{ 0 },
+        iActiveThreads{ 0 },
+        iParkedThreads{ 0 },
+        iTimerSequence{ 0 },
+        iNextDeadline{ kNoDeadline },
+        iTimerWaiter{ false },
+        iTimingEnabled{ false },
+        iSharedCounters{ std::make_unique<worker_counters>() }
     {
         reserve(std::thread::hardware_concurrency());
     }
@@ -174,8 +402,17 @@ namespace neolib
     thread_pool::~thread_pool()
     {
         wait();
+        stop();
+        iRetiredThreads.clear();
         for (auto& t : iThreads)
-            static_cast<thread_pool_thread&>(*t).stop();
+        {
+            task_queue_entry* entry = nullptr;
+            while (static_cast<thread_pool_thread&>(*t).queue().pop(entry))
+                free_entry(entry);
+        }
+        for (auto& level : iPriorityLevels)
+            for (auto entry : level->queue)
+                free_entry(entry);
     }
 
     void thread_pool::reserve(std::size_t aMaxThreads)
@@ -183,28 +420,24 @@ namespace neolib
         std::scoped_lock<std::recursive_mutex> lk(iMutex);
         iMaxThreads = aMaxThreads;
         while (iThreads.size() < iMaxThreads)
-            iThreads.push_back(std::make_unique<thread_pool_thread>(*this));
+            add_thread();
     }
 
     std::size_t thread_pool::active_threads() const
     {
-        std::scoped_lock<std::recursive_mutex> lk(iMutex);
-        std::size_t result = 0;
-        for (auto& t : iThreads)
-            if (static_cast<thread_pool_thread&>(*t).active())
-                ++result;
-        return result;
+        return iActiveThreads;
     }
 
     std::size_t thread_pool::available_threads() const
     {
-        std::scoped_lock<std::recursive_mutex> lk(iMutex);
-        return max_threads() - active_threads();
+        auto const active = active_threads();
+        auto const maximum = max_threads();
+        return active < maximum ? maximum - active : 0;
     }
 
     std::size_t thread_pool::total_threads() const
     {
-        std::scoped_lock<std::recursive_mutex> lk(iMutex);
+        std::shared_lock<std::shared_mutex> lk{ iThreadsMutex };
         std::size_t result = 0;
         for (auto& t : iThreads)
             if (!static_cast<thread_pool_thread&>(*t).finished())
@@ -217,6 +450,225 @@ namespace neolib
         return iMaxThreads;
     }
 
+    thread_placement thread_pool::placement() const
+    {
+        std::scoped_lock<std::recursive_mutex> lk(iMutex);
+        return iPlacement;
+    }
+
+    void thread_pool::set_placement(thread_placement const& aPlacement)
+    {
+        std::scoped_lock<std::recursive_mutex> lk(iMutex);
+        iPlacement = aPlacement;
+        std::shared_lock<std::shared_mutex> lk2{ iThreadsMutex };
+        for (auto& t : iThreads)
+        {
+            auto& poolThread = static_cast<thread_pool_thread&>(*t);
+            poolThread.set_affinity(iPlacement.affinity(poolThread.index()));
+        }
+    }
+
+    std::optional<thread_pool::elastic_policy> thread_pool::elastic() const
+    {
+        std::scoped_lock<std::recursive_mutex> lk(iMutex);
+        return iElasticPolicy;
+    }
+
+    void thread_pool::set_elastic(std::optional<elastic_policy> const& aPolicy)
+    {
+        std::scoped_lock<std::recursive_mutex> lk(iMutex);
+        iElasticPolicy = aPolicy;
+        if (iElasticPolicy)
+        {
+            iElasticPolicy->minThreads = std::max<std::size_t>(iElasticPolicy->minThreads, 1);
+            iElasticPolicy->maxThreads = std::max(iElasticPolicy->maxThreads, iElasticPolicy->minThreads);
+            iIdleTimeout = iElasticPolicy->idleTimeout.count();
+            iGrowthDelay = iElasticPolicy->growthDelay.count();
+            iGrowthQueueDepth = iElasticPolicy->queueDepthPerThread;
+            iMaxThreads = iElasticPolicy->maxThreads;
+            iElastic = true;
+            while (iThreads.size() < iElasticPolicy->minThreads)
+                add_thread();
+        }
+        else
+        {
+            iElastic = false;
+            reserve(iMaxThreads);
+        }
+        // parked threads pick up the new idle timeout
+        {
+            std::scoped_lock<std::mutex> lk2{ iParkMutex };
+            ++iWorkGeneration;
+        }
+        iParkConditionVariable.notify_all();
+        iTimerConditionVariable.notify_all();
+    }
+
+    void thread_pool::add_thread()
+    {
+        std::scoped_lock<std::recursive_mutex> lk(iMutex);
+        reap_retired();
+        std::size_t index = iNextThreadIndex;
+        if (!iFreeThreadIndices.empty())
+        {
+            index = *iFreeThreadIndices.begin();
+            iFreeThreadIndices.erase(iFreeThreadIndices.begin());
+        }
+        else
+            ++iNextThreadIndex;
+        auto newThread = std::make_unique<thread_pool_thread>(*this, index, iNextThreadSerial++);
+        if (iPlacement != thread_placement::any())
+            newThread->set_affinity(iPlacement.affinity(newThread->index()));
+        std::unique_lock<std::shared_mutex> lk2{ iThreadsMutex };
+        iThreads.push_back(std::move(newThread));
+        ++iThreadCount;
+    }
+
+    void thread_pool::grow_if()
+    {
+        using clock = std::chrono::steady_clock;
+        if (iParkedThreads != 0 || iQueuedTasks <= iGrowthQueueDepth * iThreadCount)
+        {
+            if (iBacklogSince != 0)
+                iBacklogSince = 0;
+            return;
+        }
+        auto const now = clock::now().time_since_epoch().count();
+        auto backlogSince = iBacklogSince.load();
+        if (backlogSince == 0)
+        {
+            iBacklogSince.compare_exchange_strong(backlogSince, now);
+            return;
+        }
+        if (now - backlogSince < iGrowthDelay || iGrowing.exchange(true))
+            return;
+        {
+            std::unique_lock<std::recursive_mutex> lk{ iMutex, std::try_to_lock };
+            if (lk.owns_lock() && iElasticPolicy && !stopped() && iThreads.size() < iElasticPolicy->maxThreads)
+            {
+                add_thread();
+                iBacklogSince = 0;
+            }
+        }
+        iGrowing = false;
+    }
+
+    bool thread_pool::retire(thread_pool_thread& aIdleThread)
+    {
+        if (!iElastic)
+            return false;
+        // try_lock so that a retiring thread never blocks on configuration changes that may be waiting on it
+        std::unique_lock<std::recursive_mutex> lk{ iMutex, std::try_to_lock };
+        if (!lk.owns_lock() || stopped() || !iElasticPolicy || iThreads.size() <= iElasticPolicy->minThreads)
+            return false;
+        std::unique_lock<std::shared_mutex> lk2{ iThreadsMutex };
+        auto existing = std::find_if(iThreads.begin(), iThreads.end(), [&](auto const& t) { return t.get() == &aIdleThread; });
+        if (existing == iThreads.end())
+            return false;
+        iSharedCounters->merge(aIdleThread.counters());
+        // the thread object can't be destroyed by its own thread so it is reaped later
+        iRetiredThreads.push_back(std::move(*existing));
+        iThreads.erase(existing);
+        --iThreadCount;
+        return true;
+    }
+
+    void thread_pool::reap_retired()
+    {
+        std::scoped_lock<std::recursive_mutex> lk(iMutex);
+        iRetiredThreads.erase(std::remove_if(iRetiredThreads.begin(), iRetiredThreads.end(), 
+            [&](auto const& t) 
+            { 
+                if (!t->finished())
+                    return false;
+                iFreeThreadIndices.insert(static_cast<thread_pool_thread&>(*t).index());
+                return true;
+            }), iRetiredThreads.end());
+    }
+
+    thread_pool::task_pointer thread_pool::run_at(std::chrono::steady_clock::time_point aWhen, std::function<void()> aFunction, int32_t aPriority)
+    {
+        if (stopped())
+            return {};
+        auto newTask = std::make_shared<scheduled_task>(*this, std::move(aFunction), aPriority);
+        schedule(newTask, aWhen);
+        return newTask;
+    }
+
+    thread_pool::task_pointer thread_pool::run_after(std::chrono::steady_clock::duration aDelay, std::function<void()> aFunction, int32_t aPriority)
+    {
+        return run_at(std::chrono::steady_clock::now() + aDelay, std::move(aFunction), aPriority);
+    }
+
+    thread_pool::task_pointer thread_pool::run_every(std::chrono::steady_clock::duration aPeriod, std::function<void()> aFunction, int32_t aPriority)
+    {
+        if (stopped())
+            return {};
+        auto newTask = std::make_shared<scheduled_task>(*this, std::move(aFunction), aPriority, aPeriod);
+        schedule(newTask, std::chrono::steady_clock::now() + aPeriod);
+        return newTask;
+    }
+
+    std::size_t thread_pool::scheduled_tasks() const
+    {
+        std::scoped_lock<std::mutex> lk{ iTimerMutex };
+        return iTimerHeap.size();
+    }
+
+    void thread_pool::schedule(std::shared_ptr<scheduled_task> aTask, std::chrono::steady_clock::time_point aDue)
+    {
+        aTask->set_due(aDue);
+        bool newEarliest = false;
+        {
+            std::scoped_lock<std::mutex> lk{ iTimerMutex };
+            iTimerHeap.push_back(timer_entry{ aDue, iTimerSequence++, std::move(aTask) });
+            std::push_heap(iTimerHeap.begin(), iTimerHeap.end(), later_timer);
+            if (aDue.time_since_epoch().count() < iNextDeadline)
+            {
+                iNextDeadline = aDue.time_since_epoch().count();
+                newEarliest = true;
+            }
+        }
+        if (newEarliest)
+        {
+            // the timer waiter (if any) must re-arm for the earlier deadline, otherwise wake a parked thread to become it
+            std::unique_lock<std::mutex> lk{ iParkMutex };
+            if (iTimerWaiter)
+            {
+                lk.unlock();
+                iTimerConditionVariable.notify_one();
+            }
+            else if (iParkedThreads != 0)
+            {
+                ++iWorkGeneration;
+                lk.unlock();
+                iParkConditionVariable.notify_one();
+            }
+        }
+    }
+
+    void thread_pool::service_timers()
+    {
+        thread_local std::vector<std::shared_ptr<scheduled_task>> tDue;
+        {
+            std::unique_lock<std::mutex> lk{ iTimerMutex, std::try_to_lock };
+            if (!lk.owns_lock())
+                return; // another thread is already releasing due tasks
+            auto const now = std::chrono::steady_clock::now();
+            while (!iTimerHeap.empty() && iTimerHeap.front().due <= now)
+            {
+                std::pop_heap(iTimerHeap.begin(), iTimerHeap.end(), later_timer);
+                tDue.push_back(std::move(iTimerHeap.back().task));
+                iTimerHeap.pop_back();
+            }
+            iNextDeadline = iTimerHeap.empty() ? kNoDeadline : iTimerHeap.front().due.time_since_epoch().count();
+        }
+        for (auto& dueTask : tDue)
+            if (!dueTask->cancelled())
+                start(dueTask, dueTask->priority());
+        tDue.clear();
+    }
+
     void thread_pool::start(i_task& aTask, int32_t aPriority)
     {
         start(task_pointer{ task_pointer{}, &aTask }, aPriority);
@@ -226,19 +678,42 @@ namespace neolib
     {
         if (stopped())
             return;
-        std::scoped_lock<std::recursive_mutex> lk(iMutex);
-        if (iThreads.empty())
+        if (max_threads() == 0)
             throw no_threads();
-        for (auto& t : iThreads)
+        auto entry = allocate_entry();
+        entry->task = aTask;
+        entry->priority = aPriority;
+        submit(entry);
+    }
+
+    void thread_pool::submit(task_queue_entry* aEntry)
+    {
+        auto const thisThread = tCurrentThread;
+        if (thisThread != nullptr && &thisThread->pool() == this && aEntry->priority == 0 && !iDefaultPriorityLimited)
         {
-            auto& tpt = static_cast<thread_pool_thread&>(*t);
-            if (!tpt.active())
-            {
-                tpt.add(aTask, aPriority);
-                return;
-            }
+            aEntry->level = nullptr;
+            if (iTimingEnabled.load(std::memory_order_relaxed))
+                aEntry->enqueued = std::chrono::steady_clock::now();
+            ++iPendingTasks;
+            ++iQueuedTasks;
+            thisThread->queue().push(aEntry);
         }
-        static_cast<thread_pool_thread&>(*iThreads[0]).add(aTask, aPriority);
+        else
+        {
+            aEntry->enqueued = std::chrono::steady_clock::now();
+            std::scoped_lock<std::mutex> lk{ iInjectionMutex };
+            auto const levelIndex = level_index(aEntry->priority);
+            aEntry->level = iPriorityLevels[levelIndex].get();
+            aEntry->level->queue.push_back(aEntry);
+            iNonEmptyLevels |= (1ull << levelIndex);
+            ++iInjectionQueueSize;
+            ++iPendingTasks;
+            ++iQueuedTasks;
+        }
+        ++iWorkGeneration;
+        unpark();
+        if (iElastic)
+            grow_if();
     }
 
     bool thread_pool::try_start(i_task& aTask, int32_t aPriority)
@@ -270,26 +745,30 @@ namespace neolib
         return std::make_pair(newTask->get_future(), newTask);
     }
 
+    bool thread_pool::try_run_one()
+    {
+        auto const thisThread = tCurrentThread;
+        auto entry = next_task(thisThread != nullptr && &thisThread->pool() == this ? thisThread : nullptr);
+        if (entry == nullptr)
+            return false;
+        execute(entry, yield_type::NoYield);
+        return true;
+    }
+
     bool thread_pool::idle() const
     {
-        return iIdle;
+        return iPendingTasks == 0;
     }
 
     void thread_pool::update_idle()
     {
-        std::scoped_lock<std::recursive_mutex> lk1(iMutex);
-        std::optional<std::unique_lock<std::mutex>> lk2;
-        for (auto& t : iThreads)
+        if (idle())
         {
-            if (!static_cast<thread_pool_thread&>(*t).idle())
             {
-                lk2.emplace(iWaitMutex);
-                iIdle = false;
-                return;
+                std::scoped_lock<std::mutex> lk{ iWaitMutex };
             }
+            iWaitConditionVariable.notify_all();
         }
-        lk2.emplace(iWaitMutex);
-        iIdle = true;
     }
 
     bool thread_pool::busy() const
@@ -314,16 +793,119 @@ namespace neolib
     {
         if (!stopped())
         {
-            for (auto& t : iThreads)
-            {
-                static_cast<thread_pool_thread&>(*t).stop();
-            }
             {
                 std::unique_lock<std::mutex> lk(iWaitMutex);
                 iStopped = true;
             }
-            iWaitConditionVariable.notify_one();
+            iWaitConditionVariable.notify_all();
+            // threads can't retire once stopped so this snapshot stays valid
+            std::vector<thread_pool_thread*> threads;
+            {
+                std::shared_lock<std::shared_mutex> lk{ iThreadsMutex };
+                for (auto& t : iThreads)
+                    threads.push_back(&static_cast<thread_pool_thread&>(*t));
+            }
+            for (auto t : threads)
+                t->stop();
+        }
+    }
+
+    void thread_pool::enable_aging(std::chrono::steady_clock::duration aInterval)
+    {
+        std::scoped_lock<std::mutex> lk{ iInjectionMutex };
+        iAgingInterval = aInterval;
+    }
+
+    void thread_pool::disable_aging()
+    {
+        std::scoped_lock<std::mutex> lk{ iInjectionMutex };
+        iAgingInterval = std::nullopt;
+    }
+
+    bool thread_pool::aging_enabled() const
+    {
+        std::scoped_lock<std::mutex> lk{ iInjectionMutex };
+        return iAgingInterval.has_value();
+    }
+
+    void thread_pool::set_concurrency_limit(int32_t aPriority, std::optional<std::size_t> const& aLimit)
+    {
+        {
+            std::scoped_lock<std::mutex> lk{ iInjectionMutex };
+            if (aLimit)
+                iPriorityLevels[level_index(aPriority, true)]->concurrencyLimit = *aLimit;
+            else
+            {
+                auto existing = std::find_if(iPriorityLevels.begin(), iPriorityLevels.end(),
+                    [aPriority](std::unique_ptr<priority_level> const& aLevel) { return aLevel->priority == aPriority; });
+                if (existing != iPriorityLevels.end())
+                    (**existing).concurrencyLimit = priority_level::kUnlimited;
+            }
+            if (aPriority == 0)
+                iDefaultPriorityLimited = aLimit.has_value();
+        }
+        // a raised limit may have released queued work
+        {
+            std::scoped_lock<std::mutex> lk{ iParkMutex };
+            ++iWorkGeneration;
+        }
+        iParkConditionVariable.notify_all();
+        iTimerConditionVariable.notify_all();
+    }
+
+    std::optional<std::size_t> thread_pool::concurrency_limit(int32_t aPriority) const
+    {
+        std::scoped_lock<std::mutex> lk{ iInjectionMutex };
+        auto existing = std::find_if(iPriorityLevels.begin(), iPriorityLevels.end(),
+            [aPriority](std::unique_ptr<priority_level> const& aLevel) { return aLevel->priority == aPriority; });
+        if (existing == iPriorityLevels.end() || (**existing).concurrencyLimit == priority_level::kUnlimited)
+            return {};
+        return (**existing).concurrencyLimit.load();
+    }
+
+    thread_pool::statistics thread_pool::snapshot() const
+    {
+        statistics result;
+        {
+            std::shared_lock<std::shared_mutex> lk{ iThreadsMutex };
+            result.workers.reserve(iThreads.size());
+            for (auto& t : iThreads)
+            {
+                auto& worker = static_cast<thread_pool_thread&>(*t);
+                auto const& counters = worker.counters();
+                result.workers.push_back(worker_statistics{ 
+                    worker.queue().size(), 
+                    worker.active(), 
+                    counters.tasksExecuted.load(std::memory_order_relaxed),
+                    counters.stealAttempts.load(std::memory_order_relaxed),
+                    counters.steals.load(std::memory_order_relaxed) });
+                counters.accumulate(result);
+            }
         }
+        iSharedCounters->accumulate(result);
+        result.injectionQueueDepth = iInjectionQueueSize;
+        result.scheduledTasks = scheduled_tasks();
+        result.activeThreads = iActiveThreads;
+        result.parkedThreads = iParkedThreads;
+        return result;
+    }
+
+    void thread_pool::reset_statistics()
+    {
+        std::shared_lock<std::shared_mutex> lk{ iThreadsMutex };
+        for (auto& t : iThreads)
+            static_cast<thread_pool_thread&>(*t).counters().reset();
+        iSharedCounters->reset();
+    }
+
+    void thread_pool::enable_timing(bool aEnable)
+    {
+        iTimingEnabled = aEnable;
+    }
+
+    bool thread_pool::timing_enabled() const
+    {
+        return iTimingEnabled;
     }
 
     thread_pool& thread_pool::default_thread_pool()
@@ -337,29 +919,316 @@ namespace neolib
         return iMutex;
     }
 
-    void thread_pool::steal_work(thread_pool_thread& aIdleThread)
+    thread_pool::task_queue_entry* thread_pool::next_task(thread_pool_thread* aThread)
     {
-        std::scoped_lock<std::recursive_mutex> lk(iMutex);
-        if (iThreads.empty())
-            throw no_threads();
-        for (auto& t : iThreads)
+        auto const nextDeadline = iNextDeadline.load(std::memory_order_relaxed);
+        if (nextDeadline != kNoDeadline && std::chrono::steady_clock::now().time_since_epoch().count() >= nextDeadline)
+            service_timers();
+        task_queue_entry* entry = nullptr;
+        if ((aThread == nullptr || !aThread->queue().pop(entry)) && iInjectionQueueSize != 0)
         {
-            if (&*t == &aIdleThread)
+            std::scoped_lock<std::mutex> lk{ iInjectionMutex };
+            entry = pop_injected();
+        }
+        if (entry == nullptr)
+            entry = steal_work(aThread);
+        if (entry != nullptr)
+            --iQueuedTasks;
+        return entry;
+    }
+
+    std::size_t thread_pool::level_index(int32_t aPriority, bool aExact)
+    {
+        auto const find = [&]()
+        {
+            return std::lower_bound(iPriorityLevels.begin(), iPriorityLevels.end(), aPriority,
+                [](std::unique_ptr<priority_level> const& aLevel, int32_t aPriority) { return aLevel->priority > aPriority; });
+        };
+        auto existing = find();
+        if (existing != iPriorityLevels.end() && (**existing).priority == aPriority)
+            return static_cast<std::size_t>(existing - iPriorityLevels.begin());
+        if (iPriorityLevels.size() == kMaxPriorityLevels)
+        {
+            reclaim_levels();
+            existing = find();
+        }
+        if (iPriorityLevels.size() == kMaxPriorityLevels)
+        {
+            if (aExact)
+                throw too_many_priority_levels();
+            // every level is in use so queue with the nearest existing priority rather than fail
+            if (existing == iPriorityLevels.end() || (existing != iPriorityLevels.begin() && 
+                static_cast<std::int64_t>((**std::prev(existing)).priority) - aPriority <= static_cast<std::int64_t>(aPriority) - (**existing).priority))
+                --existing;
+            return static_cast<std::size_t>(existing - iPriorityLevels.begin());
+        }
+        auto const index = static_cast<std::size_t>(existing - iPriorityLevels.begin());
+        iPriorityLevels.insert(existing, std::make_unique<priority_level>(aPriority));
+        // move the non-empty bits of the lower priority levels up to make room for the new level
+        auto const higherLevels = (1ull << index) - 1ull;
+        iNonEmptyLevels = (iNonEmptyLevels & higherLevels) | ((iNonEmptyLevels & ~higherLevels) << 1);
+        return index;
+    }
+
+    void thread_pool::reclaim_levels()
+    {
+        // a level can go once nothing is queued at, running at or limiting its priority as no entry then refers to it
+        iPriorityLevels.erase(std::remove_if(iPriorityLevels.begin(), iPriorityLevels.end(), 
+            [](std::unique_ptr<priority_level> const& aLevel)
+            { 
+                return aLevel->queue.empty() && aLevel->running == 0 && aLevel->concurrencyLimit == priority_level::kUnlimited;
+            }), iPriorityLevels.end());
+        iNonEmptyLevels = 0;
+        for (std::size_t index = 0; index < iPriorityLevels.size(); ++index)
+            if (!iPriorityLevels[index]->queue.empty())
+                iNonEmptyLevels |= (1ull << index);
+    }
+
+    thread_pool::task_queue_entry* thread_pool::pop_injected()
+    {
+        std::optional<std::size_t> chosen;
+        std::int64_t chosenPriority = 0;
+        auto const now = iAgingInterval ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+        for (auto levels = iNonEmptyLevels; levels != 0; levels &= levels - 1ull)
+        {
+            auto const index = static_cast<std::size_t>(std::countr_zero(levels));
+            auto const& candidate = *iPriorityLevels[index];
+            if (candidate.throttled())
+                continue;
+            if (!iAgingInterval)
+            {
+                chosen = index;
+                break;
+            }
+            // with aging the oldest entry of each level gains one priority step per aging interval waited
+            auto const effectivePriority = static_cast<std::int64_t>(candidate.priority) + 
+                static_cast<std::int64_t>((now - candidate.queue.front()->enqueued) / *iAgingInterval);
+            if (!chosen || effectivePriority > chosenPriority)
+            {
+                chosen = index;
+                chosenPriority = effectivePriority;
+            }
+        }
+        if (!chosen)
+            return nullptr;
+        auto& chosenLevel = *iPriorityLevels[*chosen];
+        auto const entry = chosenLevel.queue.front();
+        chosenLevel.queue.pop_front();
+        if (chosenLevel.queue.empty())
+            iNonEmptyLevels &= ~(1ull << *chosen);
+        ++chosenLevel.running;
+        --iInjectionQueueSize;
+        return entry;
+    }
+
+    thread_pool::task_queue_entry* thread_pool::steal_work(thread_pool_thread* aIdleThread)
+    {
+        std::shared_lock<std::shared_mutex> lk{ iThreadsMutex };
+        auto const threadCount = iThreads.size();
+        if (threadCount == 0)
+            return nullptr;
+        // randomized victim selection so that idle threads don't all converge on the same victim
+        auto const first = random_victim(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            auto& victim = static_cast<thread_pool_thread&>(*iThreads[(first + i) % threadCount]);
+            if (&victim == aIdleThread)
                 continue;
-            auto& tpt = static_cast<thread_pool_thread&>(*t);
-            if (tpt.steal_work(aIdleThread))
-                return;
+            if (victim.queue().empty())
+                continue;
+            auto& thiefCounters = aIdleThread != nullptr ? aIdleThread->counters() : *iSharedCounters;
+            worker_counters::increment(thiefCounters.stealAttempts);
+            task_queue_entry* entry = nullptr;
+            if (victim.queue().steal(entry))
+            {
+                worker_counters::increment(thiefCounters.steals);
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    bool thread_pool::park(thread_pool_thread& aIdleThread, std::size_t aWorkGeneration)
+    {
+        // the work generation changes whenever work is submitted or a throttled priority level frees
+        // up, so a thread sleeps until something it might be able to run has appeared; returns false
+        // if an elastic pool's idle timeout expired first
+        std::unique_lock<std::mutex> lk{ iParkMutex };
+        ++iParkedThreads;
+        auto const woken = [&]() { return aIdleThread.stopping() || iWorkGeneration != aWorkGeneration; };
+        bool result = true;
+        if (!iTimerWaiter && iNextDeadline != kNoDeadline)
+        {
+            // one parked thread sleeps only until the next timer deadline so scheduled tasks are released on time
+            iTimerWaiter = true;
+            for (auto deadline = iNextDeadline.load(); !woken() && deadline != kNoDeadline &&
+                std::chrono::steady_clock::now().time_since_epoch().count() < deadline; deadline = iNextDeadline.load())
+                iTimerConditionVariable.wait_until(lk, std::chrono::steady_clock::time_point{ std::chrono::steady_clock::duration{ deadline } });
+            iTimerWaiter = false;
+        }
+        else if (iElastic)
+            result = iParkConditionVariable.wait_for(lk, std::chrono::steady_clock::duration{ iIdleTimeout.load() }, woken);
+        else
+            iParkConditionVariable.wait(lk, woken);
+        --iParkedThreads;
+        return result;
+    }
+
+    void thread_pool::unpark()
+    {
+        if (iParkedThreads != 0)
+        {
+            bool onlyTimerWaiterParked = false;
+            {
+                std::scoped_lock<std::mutex> lk{ iParkMutex };
+                onlyTimerWaiterParked = iTimerWaiter && iParkedThreads == 1;
+            }
+            if (onlyTimerWaiterParked)
+                iTimerConditionVariable.notify_one();
+            else
+                iParkConditionVariable.notify_one();
         }
     }
 
-    void thread_pool::thread_gone_idle()
+    thread_pool::task_queue_entry* thread_pool::allocate_entry()
+    {
+        return entry_cache<task_queue_entry>::instance().allocate();
+    }
+
+    void thread_pool::free_entry(task_queue_entry* aEntry)
     {
-        update_idle();
-        iWaitConditionVariable.notify_one();
+        if (aEntry->destroy != nullptr)
+            aEntry->destroy(*aEntry);
+        aEntry->invoke = nullptr;
+        aEntry->destroy = nullptr;
+        aEntry->task = nullptr;
+        aEntry->enqueued = {};
+        entry_cache<task_queue_entry>::instance().free(aEntry);
     }
 
-    void thread_pool::thread_gone_busy()
+    void thread_pool::execute(task_queue_entry* aEntry, yield_type aYieldType)
     {
-        update_idle();
+        auto& workerCounters = counters();
+        std::optional<std::chrono::steady_clock::time_point> started;
+        if (iTimingEnabled.load(std::memory_order_relaxed))
+        {
+            started = std::chrono::steady_clock::now();
+            if (aEntry->enqueued != std::chrono::steady_clock::time_point{})
+                worker_counters::record(workerCounters.startLatency, *started - aEntry->enqueued);
+        }
+        // a task that throws must still complete or wait() would never return; the exception
+        // has nowhere to go from a worker thread so it is reported and dropped
+        try
+        {
+            if (aEntry->invoke != nullptr)
+                aEntry->invoke(*aEntry);
+            else if (!aEntry->task->cancelled())
+                aEntry->task->run(aYieldType);
+        }
+        catch (const std::exception& aException)
+        {
+            std::cerr << std::string("neolib::thread_pool: task threw an exception (") + aException.what() + ")." << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << std::string("neolib::thread_pool: task threw an exception of unknown type.") << std::endl;
+        }
+        if (started)
+            worker_counters::record(workerCounters.runTime, std::chrono::steady_clock::now() - *started);
+        worker_counters::increment(workerCounters.tasksExecuted);
+        task_completed(aEntry);
+    }
+
+    void thread_pool::task_completed(task_queue_entry* aEntry)
+    {
+        if (aEntry->level != nullptr)
+        {
+            // the level may be reclaimed as soon as its running count drops so that must be the last access to it
+            auto& level = *aEntry->level;
+            auto const limit = level.concurrencyLimit.load();
+            if (level.running-- >= limit)
+            {
+                ++iWorkGeneration;
+                unpark();
+            }
+        }
+        free_entry(aEntry);
+        if (--iPendingTasks == 0)
+        {
+            {
+                std::scoped_lock<std::mutex> lk{ iWaitMutex };
+            }
+            iWaitConditionVariable.notify_all();
+        }
+    }
+
+    thread_pool::worker_counters& thread_pool::counters()
+    {
+        auto const thisThread = tCurrentThread;
+        if (thisThread != nullptr && &thisThread->pool() == this)
+            return thisThread->counters();
+        return *iSharedCounters;
+    }
+
+    task_group::task_group(thread_pool& aThreadPool) :
+        iThreadPool{ aThreadPool },
+        iOutstanding{ 0 }
+    {
+    }
+
+    task_group::~task_group()
+    {
+        wait_no_throw();
+    }
+
+    thread_pool& task_group::pool() const
+    {
+        return iThreadPool;
+    }
+
+    std::size_t task_group::outstanding() const
+    {
+        return iOutstanding;
+    }
+
+    bool task_group::done() const
+    {
+        return iOutstanding == 0;
+    }
+
+    void task_group::wait()
+    {
+        wait_no_throw();
+        std::exception_ptr exception;
+        {
+            std::scoped_lock<std::mutex> lk{ iMutex };
+            std::swap(exception, iException);
+        }
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+    void task_group::task_done(std::exception_ptr aException)
+    {
+        std::scoped_lock<std::mutex> lk{ iMutex };
+        if (aException && !iException)
+            iException = aException;
+        if (--iOutstanding == 0)
+            iConditionVariable.notify_all();
+    }
+
+    void task_group::wait_no_throw()
+    {
+        while (!done())
+        {
+            if (iThreadPool.try_run_one())
+                continue;
+            // nothing to help with so the rest of the group must be running elsewhere; block until a
+            // member completes, rechecking periodically in case new work becomes available to help with
+            std::unique_lock<std::mutex> lk{ iMutex };
+            iConditionVariable.wait_for(lk, std::chrono::milliseconds{ 1 }, [this]() { return done(); });
+        }
+        // synchronize with the final task_done() so it has released the mutex before we can be destroyed
+        std::scoped_lock<std::mutex> lk{ iMutex };
     }
 }
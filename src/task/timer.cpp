@@ -43,6 +43,7 @@ namespace neolib
         iTaskDestroying{ aTask },
         iTaskDestroyed{ aTask },
         iDuration_s{ aDuration_s },
+        iSlack_s{ 0.0 },
         iEnabled{ true },
         iWaiting{ false },
         iInReady{ false }
@@ -57,6 +58,7 @@ namespace neolib
         iTaskDestroyed{ aTask },
         iContextDestroyed{ aContext },
         iDuration_s{ aDuration_s },
+        iSlack_s{ 0.0 },
         iEnabled{ true },
         iWaiting{ false },
         iInReady{ false }
@@ -71,6 +73,7 @@ namespace neolib
         iTaskDestroyed{ aOther.iTask },
         iContextDestroyed{ aOther.iContextDestroyed },
         iDuration_s{ aOther.iDuration_s },
+        iSlack_s{ aOther.iSlack_s },
         iEnabled{ aOther.iEnabled },
         iWaiting{ false },
         iInReady{ false }
@@ -84,6 +87,7 @@ namespace neolib
         if (waiting())
             cancel();
         iDuration_s = aOther.iDuration_s;
+        iSlack_s = aOther.iSlack_s;
         iEnabled = aOther.iEnabled;
         if (aOther.waiting())
             again();
@@ -94,6 +98,8 @@ namespace neolib
     {
         cancel();
         unsubscribe();
+        if (iTimerObject && !iTaskDestroying && !iTaskDestroyed)
+            iTask.timer_service().remove_timer_object(*iTimerObject);
     }
 
     i_async_task& timer::owner_task() const
@@ -137,6 +143,7 @@ namespace neolib
             enable(false);
         if (waiting())
             throw already_waiting();
+        timer_object().set_slack(std::chrono::duration_cast<std::chrono::steady_clock::duration>(iSlack_s));
         timer_object().expires_from_now(iDuration_s);
         if (iTimerSubscriber)
             timer_object().async_wait(*iTimerSubscriber);
@@ -188,6 +195,18 @@ namespace neolib
         }
     }
 
+    const timer::duration_type& timer::slack() const
+    {
+        return iSlack_s;
+    }
+
+    void timer::set_slack(const duration_type& aSlack_s)
+    {
+        iSlack_s = aSlack_s;
+        if (waiting() && !iTaskDestroying && !iTaskDestroyed)
+            timer_object().set_slack(std::chrono::duration_cast<std::chrono::steady_clock::duration>(iSlack_s));
+    }
+
     void timer::set_debug(bool aDebug)
     {
 #if !defined(NDEBUG) || defined(DEBUG_TIMER_OBJECTS)
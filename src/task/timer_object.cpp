@@ -40,7 +40,7 @@
 namespace neolib
 {
     timer_object::timer_object(i_timer_service& aService) : 
-        iService{ aService }
+        iService{ &aService }
     {
     }
 
@@ -62,6 +62,8 @@ namespace neolib
             std::cerr << "timer_object::expires_at(...)" << std::endl;
 #endif
         iExpiryTime = aDeadline;
+        if (iService != nullptr)
+            iService->deadline_changed(*this);
     }
 
     void timer_object::async_wait(i_timer_subscriber& aSubscriber)
@@ -95,6 +97,32 @@ namespace neolib
             std::cerr << "timer_object::cancel()" << std::endl;
 #endif
         iExpiryTime = std::nullopt;
+        if (iService != nullptr)
+            iService->deadline_changed(*this);
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> timer_object::expiry_time() const
+    {
+        return iExpiryTime;
+    }
+
+    std::chrono::steady_clock::duration timer_object::slack() const
+    {
+        return iSlack;
+    }
+
+    void timer_object::set_slack(const std::chrono::steady_clock::duration& aSlack)
+    {
+        if (iSlack == aSlack)
+            return;
+        iSlack = aSlack;
+        if (iExpiryTime && iService != nullptr)
+            iService->deadline_changed(*this);
+    }
+
+    void timer_object::detach_service()
+    {
+        iService = nullptr;
     }
 
     bool timer_object::poll()
@@ -50,6 +50,7 @@ namespace neolib
         iReady = true;
         iSignalType = SignalOne;
         iCondVar.notify_one();
+        iWaiters.notify();
     }
 
     void waitable_event::signal_all() const
@@ -58,6 +59,7 @@ namespace neolib
         iReady = true;
         iSignalType = SignalAll;
         iCondVar.notify_all();
+        iWaiters.notify();
     }
 
     void waitable_event::wait() const
@@ -86,29 +88,14 @@ namespace neolib
 
     bool waitable_event::msg_wait(const i_message_queue& aMessageQueue) const
     {
-        for(;;)
-        {
-            if (wait(0))
-                return true;
-            else if (aMessageQueue.have_message())
-                return false;
-            this_thread::yield();
-        }
+        return std::holds_alternative<wait_result_event>(*waitable_event_list{ *this }.do_wait(&aMessageQueue, nullptr));
     }
 
     bool waitable_event::msg_wait(const i_message_queue& aMessageQueue, uint32_t aTimeout_ms) const
     {
-        auto startTime = std::chrono::steady_clock::now();
-        for(;;)
-        {
-            if (wait(0))
-                return true;
-            else if (aMessageQueue.have_message())
-                return false;
-            else if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() > aTimeout_ms)
-                return false;
-            this_thread::yield();
-        }
+        auto const result = waitable_event_list{ *this }.do_wait(&aMessageQueue, nullptr, 
+            std::chrono::steady_clock::now() + std::chrono::milliseconds{ aTimeout_ms });
+        return result && std::holds_alternative<wait_result_event>(*result);
     }
 
     void waitable_event::reset() const
@@ -117,55 +104,57 @@ namespace neolib
         iReady = false;
     }
 
+    void waitable_event::add_waiter(waiter& aWaiter) const
+    {
+        iWaiters.add(aWaiter);
+    }
+
+    void waitable_event::remove_waiter(waiter& aWaiter) const
+    {
+        iWaiters.remove(aWaiter);
+    }
+
     wait_result waitable_event_list::wait() const
     {
-        for(;;)
-        {
-            for (list_type::const_iterator i = iEvents.begin(); i != iEvents.end(); ++i)
-                if ((**i).wait(0))
-                    return wait_result_event(**i);
-            this_thread::yield();
-        }
+        return *do_wait(nullptr, nullptr);
     }
 
     wait_result waitable_event_list::wait(const waitable& aWaitable) const
     {
-        for(;;)
-        {
-            for (list_type::const_iterator i = iEvents.begin(); i != iEvents.end(); ++i)
-                if ((**i).wait(0))
-                    return wait_result_event(**i);
-            if (aWaitable.waitable_ready())
-                return wait_result_waitable();
-            this_thread::yield();
-        }
+        return *do_wait(nullptr, &aWaitable);
     }
 
     wait_result waitable_event_list::msg_wait(const i_message_queue& aMessageQueue) const
     {
-        for(;;)
-        {
-            for (list_type::const_iterator i = iEvents.begin(); i != iEvents.end(); ++i)
-                if ((**i).wait(0))
-                    return wait_result_event(**i);
-            if (aMessageQueue.have_message())
-                return wait_result_message();
-            this_thread::yield();
-        }
+        return *do_wait(&aMessageQueue, nullptr);
     }
 
     wait_result waitable_event_list::msg_wait(const i_message_queue& aMessageQueue, const waitable& aWaitable) const
     {
+        return *do_wait(&aMessageQueue, &aWaitable);
+    }
+
+    std::optional<wait_result> waitable_event_list::do_wait(const i_message_queue* aMessageQueue, const waitable* aWaitable, 
+        std::optional<std::chrono::steady_clock::time_point> const& aDeadline) const
+    {
+        // register before checking so that a notification between the check and the wait is not lost
+        scoped_waiter w{ iEvents, aMessageQueue, aWaitable };
         for(;;)
         {
             for (list_type::const_iterator i = iEvents.begin(); i != iEvents.end(); ++i)
                 if ((**i).wait(0))
                     return wait_result_event(**i);
-            if (aMessageQueue.have_message())
+            if (aMessageQueue != nullptr && aMessageQueue->have_message())
                 return wait_result_message();
-            if (aWaitable.waitable_ready())
+            if (aWaitable != nullptr && aWaitable->waitable_ready())
                 return wait_result_waitable();
-            this_thread::yield();
+            auto const now = std::chrono::steady_clock::now();
+            if (aDeadline && *aDeadline <= now)
+                return {};
+            auto deadline = aDeadline;
+            if (w.poll() && (!deadline || *deadline > now + std::chrono::milliseconds{ 1 }))
+                deadline = now + std::chrono::milliseconds{ 1 };
+            w.wait(deadline);
         }
     }
 } // namespace neolib
@@ -0,0 +1,312 @@
+#include <neolib/neolib.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <neolib/task/async_thread.hpp>
+#include <neolib/ecs/ecs.hpp>
+#include <neolib/ecs/archetype_storage.hpp>
+#include <neolib/ecs/system.hpp>
+#include <neolib/ecs/system_scheduler.hpp>
+
+namespace test
+{
+    template <std::uint8_t Id>
+    struct scalar
+    {
+        double value;
+
+        struct meta : neolib::ecs::i_component_data::meta
+        {
+            static const neolib::uuid& id()
+            {
+                static const neolib::uuid sId = { 0x3b1e02c4, 0x7d1a, 0x4c59, 0x9a0e, { 0x61, 0x2f, 0xc8, 0x05, 0x9e, Id } };
+                return sId;
+            }
+            static const neolib::i_string& name()
+            {
+                static const neolib::string sName = "Scalar " + std::to_string(Id);
+                return sName;
+            }
+            static uint32_t field_count()
+            {
+                return 1;
+            }
+            static neolib::ecs::component_data_field_type field_type(uint32_t aFieldIndex)
+            {
+                if (aFieldIndex == 0)
+                    return neolib::ecs::component_data_field_type::Float64;
+                throw invalid_field_index();
+            }
+            static const neolib::i_string& field_name(uint32_t aFieldIndex)
+            {
+                static const neolib::string sFieldName = "Value";
+                if (aFieldIndex == 0)
+                    return sFieldName;
+                throw invalid_field_index();
+            }
+        };
+    };
+
+    typedef scalar<1> position;
+    typedef scalar<2> velocity;
+
+    template <std::uint8_t Id, typename... ComponentData>
+    class probe_system : public neolib::ecs::system<ComponentData...>
+    {
+    public:
+        struct meta
+        {
+            static const neolib::uuid& id()
+            {
+                static const neolib::uuid sId = { 0x5d0c7a91, 0x2e4b, 0x4f1d, 0xb3a6, { 0x0c, 0x7e, 0x41, 0xd2, 0x88, Id } };
+                return sId;
+            }
+            static const neolib::i_string& name()
+            {
+                static const neolib::string sName = "Probe " + std::to_string(Id);
+                return sName;
+            }
+        };
+    public:
+        probe_system(neolib::ecs::i_ecs& aEcs) :
+            neolib::ecs::system<ComponentData...>{ aEcs }
+        {
+        }
+    public:
+        const neolib::ecs::system_id& id() const override
+        {
+            return meta::id();
+        }
+        const neolib::i_string& name() const override
+        {
+            return meta::name();
+        }
+        bool apply() override
+        {
+            if (action)
+                action();
+            return true;
+        }
+    public:
+        std::function<void()> action;
+    };
+
+    void test_assert(bool aAssertion)
+    {
+        if (!aAssertion)
+            throw std::logic_error("failed");
+    }
+
+    void archetype_storage()
+    {
+        neolib::ecs::ecs ecs{ neolib::ecs::ecs_flags::PopulateEntityInfo | neolib::ecs::ecs_flags::NoThreads };
+        neolib::ecs::chunked_archetype<position, velocity> mover{ "mover" };
+        ecs.register_archetype(mover);
+        auto& storage = ecs.archetype_storage(mover);
+        auto const capacity = storage.chunk_capacity();
+
+        std::vector<neolib::ecs::entity_id> entities;
+        {
+            // creating by archetype id populates the storage before the entity is announced
+            bool announcedComplete = false;
+            neolib::sink sink;
+            sink += ecs.entity_created([&](neolib::ecs::entity_id aEntity)
+            {
+                announcedComplete = storage.has_entity(aEntity) && storage.entity_record<position>(aEntity).value == 0.0 &&
+                    storage.entity_record<velocity>(aEntity).value == 1.0;
+            });
+            entities.push_back(ecs.create_entity(mover.id(), velocity{ 1.0 }));
+            test_assert(announcedComplete && !ecs.component_instantiated(velocity::meta::id()));
+        }
+        for (std::size_t i = 1; i < capacity + 2; ++i)
+            entities.push_back(ecs.create_entity(mover, position{ static_cast<double>(i) }, velocity{ 1.0 }));
+        test_assert(storage.entity_count() == capacity + 2 && storage.chunk_count() == 2 && storage.chunk_size(1) == 2);
+
+        // destroying an entity moves the last entity of the last chunk into its row
+        auto const moved = entities.back();
+        ecs.destroy_entity(entities[1]);
+        test_assert(storage.chunk_entities(0)[1] == moved && storage.entity_record<position>(moved).value == static_cast<double>(capacity + 1));
+        test_assert(!storage.has_entity(entities[1]) && storage.entity_count() == capacity + 1 && storage.chunk_size(1) == 1);
+
+        // the last row of the last chunk is removed in place and an emptied chunk is freed
+        ecs.destroy_entity(entities[capacity]);
+        test_assert(storage.entity_count() == capacity && storage.chunk_count() == 1 && storage.chunk_size(0) == capacity);
+        for (std::size_t i = 2; i < capacity; ++i)
+            test_assert(storage.entity_record<position>(entities[i]).value == static_cast<double>(i));
+        std::size_t visited = 0;
+        ecs.apply_chunks<position, const velocity>([&](std::span<const neolib::ecs::entity_id> aEntities, std::span<position> aPositions, std::span<const velocity> aVelocities)
+        {
+            test_assert(aEntities.size() == aPositions.size() && aEntities.size() == aVelocities.size());
+            visited += aEntities.size();
+        });
+        test_assert(visited == capacity);
+        std::cout << "neolib ecs archetype storage: " << storage.entity_count() << " entities in " << storage.chunk_count() << " chunk(s) of " << capacity << std::endl;
+    }
+
+    void sparse_index()
+    {
+        typedef neolib::ecs::paged_sparse_index<std::size_t, 64u> index_t;
+        index_t index{ ~std::size_t{} };
+        index.set(1, 10);
+        index.set(65, 20);
+        index.set(66, 30);
+        index.set(1000, 40);
+        test_assert(index.page_count() == 3 && index[65] == 20 && index[2] == index.invalid() && !index.contains(500));
+
+        // a page is freed once its last entry is reset; setting invalid() is a reset
+        index.reset(65);
+        test_assert(index.page_count() == 3 && index[66] == 30);
+        index.set(66, index.invalid());
+        test_assert(index.page_count() == 2 && !index.contains(66));
+        index.reset(66);
+        index.reset(12345);
+        test_assert(index.page_count() == 2);
+
+        // copies are deep; a moved-from index is left empty
+        index_t copy{ index };
+        copy.set(1, 11);
+        copy.set(130, 50);
+        test_assert(index[1] == 10 && !index.contains(130) && copy[1] == 11 && copy[1000] == 40 && copy.page_count() == 3);
+        index = copy;
+        test_assert(index[1] == 11 && index[130] == 50 && index.page_count() == 3);
+        index_t moved{ std::move(copy) };
+        test_assert(moved[1000] == 40 && moved.page_count() == 3 && copy.page_count() == 0);
+        moved.reset(1000);
+        moved.reset(130);
+        moved.reset(1);
+        test_assert(moved.page_count() == 0 && !moved.contains(1));
+        index.clear();
+        test_assert(index.page_count() == 0 && !index.contains(1000));
+        std::cout << "neolib ecs sparse index: OK" << std::endl;
+    }
+
+    void views()
+    {
+        neolib::ecs::ecs ecs{ neolib::ecs::ecs_flags::PopulateEntityInfo | neolib::ecs::ecs_flags::NoThreads };
+        neolib::ecs::entity_archetype plain{ "plain", {} };
+        std::vector<neolib::ecs::entity_id> entities;
+        for (int i = 0; i < 10; ++i)
+        {
+            entities.push_back(ecs.create_entity(plain));
+            ecs.populate(entities.back(), position{ static_cast<double>(i) });
+        }
+        ecs.populate(entities[9], velocity{ 1.0 });
+        ecs.populate(entities[2], velocity{ 2.0 });
+
+        typedef neolib::ecs::view<position, const velocity> view_t;
+        static_assert(std::is_same_v<std::tuple_element_t<1, view_t::value_type>, position&>);
+        static_assert(std::is_same_v<std::tuple_element_t<2, view_t::value_type>, const velocity&>);
+
+        // velocity has fewer records so it drives the iteration: entities come in its order, not position's
+        std::vector<neolib::ecs::entity_id> visited;
+        for (auto [entity, p, v] : ecs.view<position, const velocity>())
+        {
+            p.value += v.value;
+            visited.push_back(entity);
+        }
+        test_assert((visited == std::vector<neolib::ecs::entity_id>{ entities[9], entities[2] }));
+        test_assert(ecs.component<position>().entity_record(entities[9]).value == 10.0 && ecs.component<position>().entity_record(entities[2]).value == 4.0);
+
+        // the cache picks up records added and removed after it was built
+        view_t::cache_type cache{ ecs };
+        auto const cached = [&]()
+        {
+            std::vector<neolib::ecs::entity_id> result;
+            ecs.view(cache).each([&](neolib::ecs::entity_id aEntity, position&, const velocity&) { result.push_back(aEntity); });
+            std::sort(result.begin(), result.end());
+            return result;
+        };
+        test_assert((cached() == std::vector<neolib::ecs::entity_id>{ entities[2], entities[9] }));
+        ecs.populate(entities[5], velocity{ 3.0 });
+        ecs.destroy_entity(entities[2]);
+        ecs.component<velocity>().destroy_entity_record(entities[9]);
+        ecs.populate(entities[7], velocity{ 4.0 });
+        test_assert((cached() == std::vector<neolib::ecs::entity_id>{ entities[5], entities[7] }));
+        std::size_t counted = 0;
+        for (auto [entity, p, v] : ecs.view(cache))
+            counted += (p.value == static_cast<double>(entity == entities[5] ? 5 : 7));
+        test_assert(counted == 2);
+        std::cout << "neolib ecs views: OK" << std::endl;
+    }
+
+    void system_scheduler()
+    {
+        neolib::ecs::ecs ecs{ neolib::ecs::ecs_flags::PopulateEntityInfo | neolib::ecs::ecs_flags::ParallelSystems };
+        ecs.thread_pool().reserve(2);
+        auto& firstReader = ecs.system<probe_system<1, const position>>();
+        auto& secondReader = ecs.system<probe_system<2, const position, const velocity>>();
+        auto& writer = ecs.system<probe_system<3, position>>();
+        auto& reader = ecs.system<probe_system<4, const position>>();
+        auto& unrelated = ecs.system<probe_system<5, velocity>>();
+        test_assert(!neolib::ecs::system_scheduler::conflicts(firstReader, secondReader));
+        test_assert(neolib::ecs::system_scheduler::conflicts(writer, reader) && neolib::ecs::system_scheduler::conflicts(reader, writer));
+        test_assert(!neolib::ecs::system_scheduler::conflicts(writer, unrelated) && neolib::ecs::system_scheduler::conflicts(secondReader, unrelated));
+
+        // readers of the same component run concurrently: each waits for the other to arrive
+        std::atomic<int> arrived = 0;
+        std::atomic<int> met = 0;
+        auto const rendezvous = [&]()
+        {
+            ++arrived;
+            auto const giveUp = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+            while (arrived < 2 && std::chrono::steady_clock::now() < giveUp)
+                std::this_thread::yield();
+            if (arrived >= 2)
+                ++met;
+        };
+        firstReader.action = rendezvous;
+        secondReader.action = rendezvous;
+        neolib::ecs::system_scheduler readers{ ecs };
+        readers.add_system(firstReader);
+        readers.add_system(secondReader);
+        readers.run();
+        test_assert(met == 2);
+
+        // a writer and a reader of the same component are ordered: the reader never starts while the
+        // writer (which gives it a chance to) is still running
+        std::atomic<bool> writing = false;
+        std::atomic<bool> readerStarted = false;
+        std::atomic<bool> overlapped = false;
+        writer.action = [&]()
+        {
+            writing = true;
+            auto const giveUp = std::chrono::steady_clock::now() + std::chrono::milliseconds{ 100 };
+            while (!readerStarted && std::chrono::steady_clock::now() < giveUp)
+                std::this_thread::yield();
+            writing = false;
+        };
+        reader.action = [&]()
+        {
+            readerStarted = true;
+            if (writing)
+                overlapped = true;
+        };
+        neolib::ecs::system_scheduler ordered{ ecs };
+        ordered.add_system(writer);
+        ordered.add_system(reader);
+        ordered.run();
+        test_assert(readerStarted && !overlapped);
+        std::cout << "neolib ecs system scheduler: OK" << std::endl;
+    }
+}
+
+template<> neolib::i_async_task& neolib::services::start_service<neolib::i_async_task>()
+{
+    static neolib::async_task mainTask;
+    static neolib::async_thread mainThread{ mainTask, "neolib::ecs unit test(s)", true };
+    return mainTask;
+}
+
+int main()
+{
+    neolib::allocate_service_provider();
+
+    test::archetype_storage();
+    test::sparse_index();
+    test::views();
+    test::system_scheduler();
+}
@@ -106,4 +106,159 @@ int main()
 		c.count(10); // should only print "not in sink"
 		neolib::async_event_queue::instance().pump_events();
 	}
+
+	{
+		neolib::event<int> shared;
+		std::atomic<long> calls = 0;
+		neolib::sink sharedSink;
+		sharedSink += ~shared([&](int) { ++calls; });
+		std::atomic<bool> stop = false;
+		std::thread churn{ [&]() 
+			{ 
+				neolib::async_event_queue::instance();
+				while (!stop) 
+				{ 
+					neolib::sink s; 
+					s += shared([](int) {}); 
+				}
+			} };
+		std::vector<std::thread> triggers;
+		for (int t = 0; t < 3; ++t)
+			triggers.emplace_back([&]() { for (int i = 0; i < 10000; ++i) shared.trigger(i); });
+		for (auto& t : triggers)
+			t.join();
+		stop = true;
+		churn.join();
+		std::cout << "concurrent triggers: " << calls << " calls" << std::endl;
+		if (calls != 30000)
+			throw std::logic_error("failed");
+
+		int afterAccept = 0;
+		neolib::sink acceptSink;
+		acceptSink += shared([&](int) { shared.accept(); });
+		acceptSink += shared([&](int) { ++afterAccept; });
+		sharedSink.clear();
+		if (shared.trigger(0) != neolib::trigger_result::Accepted || afterAccept != 0)
+			throw std::logic_error("failed");
+	}
+
+	{
+		neolib::event<int> queued;
+		neolib::event<int> latestOnly;
+		latestOnly.set_trigger_type(neolib::trigger_type::AsynchronousDontQueue);
+		std::atomic<long> queuedCalls = 0;
+		std::atomic<int> latest = 0;
+		std::atomic<bool> ready = false;
+		std::atomic<bool> stop = false;
+		std::thread consumer{ [&]()
+			{
+				neolib::sink s;
+				s += queued([&](int) { ++queuedCalls; });
+				s += latestOnly([&](int n) { latest = n; });
+				neolib::async_event_queue::instance();
+				ready = true;
+				while (!stop)
+					neolib::async_event_queue::instance().pump_events();
+				neolib::async_event_queue::instance().pump_events();
+			} };
+		while (!ready)
+			std::this_thread::yield();
+		std::vector<std::thread> producers;
+		for (int t = 0; t < 3; ++t)
+			producers.emplace_back([&]() { for (int i = 0; i < 10000; ++i) queued.trigger(i); });
+		for (auto& p : producers)
+			p.join();
+		for (int i = 1; i <= 100; ++i)
+			latestOnly.trigger(i);
+		while (queuedCalls != 30000 || latest != 100)
+			std::this_thread::yield();
+		stop = true;
+		consumer.join();
+		std::cout << "cross-thread queue: " << queuedCalls << " calls, latest " << latest << std::endl;
+
+		std::atomic<int> coalescedCalls = 0;
+		std::atomic<int> coalescedLatest = 0;
+		std::atomic<int> batches = 0;
+		std::atomic<int> batchedCalls = 0;
+		std::atomic<bool> deliveryReady = false;
+		std::atomic<bool> deliveryStop = false;
+		neolib::event<int> updates;
+		std::thread deliveryConsumer{ [&]()
+			{
+				neolib::sink s;
+				s += updates([&](int n) { ++coalescedCalls; coalescedLatest = n; }).coalesce();
+				s += updates.batched([&](std::span<std::tuple<int> const> aCalls) { ++batches; batchedCalls += static_cast<int>(aCalls.size()); });
+				deliveryReady = true;
+				while (!deliveryStop)
+					std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+				neolib::async_event_queue::instance().pump_events();
+			} };
+		while (!deliveryReady)
+			std::this_thread::yield();
+		for (int i = 1; i <= 1000; ++i)
+			updates.trigger(i);
+		deliveryStop = true;
+		deliveryConsumer.join();
+		std::cout << "coalesced: " << coalescedCalls << " call(s), latest " << coalescedLatest << "; batched: " << batchedCalls << " calls in " << batches << " batch(es)" << std::endl;
+		if (coalescedCalls != 1 || coalescedLatest != 1000 || batches != 1 || batchedCalls != 1000)
+			throw std::logic_error("failed");
+
+		// deferred calls keep copies of reference arguments that are gone by the time they are delivered
+		std::string coalescedName;
+		std::vector<std::string> batchedNames;
+		deliveryReady = false;
+		deliveryStop = false;
+		neolib::event<std::string const&> renamed;
+		std::thread renameConsumer{ [&]()
+			{
+				neolib::sink s;
+				s += renamed([&](std::string const& aName) { coalescedName = aName; }).coalesce();
+				s += renamed.batched([&](std::span<std::tuple<std::string> const> aCalls) { for (auto const& call : aCalls) batchedNames.push_back(std::get<0>(call)); });
+				deliveryReady = true;
+				while (!deliveryStop)
+					std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+				neolib::async_event_queue::instance().pump_events();
+			} };
+		while (!deliveryReady)
+			std::this_thread::yield();
+		for (int i = 1; i <= 3; ++i)
+			renamed.trigger(std::string(32, static_cast<char>('a' + i)));
+		deliveryStop = true;
+		renameConsumer.join();
+		if (coalescedName != std::string(32, 'd') || batchedNames.size() != 3 || batchedNames[0] != std::string(32, 'b'))
+			throw std::logic_error("failed");
+
+		// the slot outlives its thread (and its thread's queue) so the call is discarded
+		std::thread{ [&]() { queued([&](int) { ++queuedCalls; }); } }.join();
+		queued.trigger(0);
+		if (queuedCalls != 30000)
+			throw std::logic_error("failed");
+	}
+
+	{
+		// a task only pumps event queues that have become ready
+		neolib::async_task readyTask{ "test::ready" };
+		readyTask.set_reactor_mode(true);
+		neolib::async_thread readyThread{ readyTask, "test::ready" };
+		readyThread.start();
+		neolib::event<int> posted;
+		std::atomic<long> postedCalls = 0;
+		neolib::sink postedSink;
+		std::atomic<bool> subscribed = false;
+		readyTask.post([&]() { postedSink += posted([&](int) { ++postedCalls; }); subscribed = true; });
+		while (!subscribed)
+			std::this_thread::yield();
+		std::vector<std::thread> producers;
+		for (int t = 0; t < 4; ++t)
+			producers.emplace_back([&]() { for (int i = 0; i < 10000; ++i) posted.trigger(i); });
+		for (auto& p : producers)
+			p.join();
+		while (postedCalls != 40000)
+			std::this_thread::yield();
+		std::cout << "ready list: " << postedCalls << " calls" << std::endl;
+		std::atomic<bool> unsubscribed = false;
+		readyTask.post([&]() { postedSink.clear(); unsubscribed = true; });
+		while (!unsubscribed)
+			std::this_thread::yield();
+	}
 }
\ No newline at end of file
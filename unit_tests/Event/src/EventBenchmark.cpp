@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <neolib/task/event.hpp>
+#include <neolib/task/async_thread.hpp>
+
+template<> neolib::i_async_task& neolib::services::start_service<neolib::i_async_task>()
+{
+	static neolib::async_task mainTask;
+	static neolib::async_thread mainThread{ mainTask, "neolib::event benchmark(s)", true };
+	return mainTask;
+}
+
+namespace
+{
+	typedef std::chrono::steady_clock clock_type;
+
+	double ns_per(clock_type::duration aElapsed, std::size_t aCount)
+	{
+		return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(aElapsed).count()) / static_cast<double>(aCount);
+	}
+
+	void sync_trigger(std::size_t aSlots)
+	{
+		neolib::event<int> e;
+		neolib::sink s;
+		long total = 0;
+		for (std::size_t i = 0; i < aSlots; ++i)
+			s += e([&](int n) { total += n; });
+		std::size_t const triggers = 1000000 / aSlots;
+		auto const start = clock_type::now();
+		for (std::size_t i = 0; i < triggers; ++i)
+			e.trigger(1);
+		auto const elapsed = clock_type::now() - start;
+		std::cout << "sync trigger, " << aSlots << " slot(s): " << ns_per(elapsed, triggers) << " ns/trigger, " <<
+			ns_per(elapsed, triggers * aSlots) << " ns/slot call" << std::endl;
+		if (total != static_cast<long>(triggers * aSlots))
+			throw std::logic_error("failed");
+	}
+
+	void async_throughput(int aProducers)
+	{
+		neolib::async_task task{ "benchmark::consumer" };
+		task.set_reactor_mode(true);
+		neolib::async_thread thread{ task, "benchmark::consumer" };
+		thread.start();
+		neolib::event<int> e;
+		neolib::sink s;
+		std::atomic<long> calls = 0;
+		std::atomic<bool> subscribed = false;
+		task.post([&]() { s += e([&](int) { ++calls; }); subscribed = true; });
+		while (!subscribed)
+			std::this_thread::yield();
+		int const perProducer = 1000000 / aProducers;
+		auto const start = clock_type::now();
+		std::vector<std::thread> producers;
+		for (int p = 0; p < aProducers; ++p)
+			producers.emplace_back([&]() { for (int i = 0; i < perProducer; ++i) e.trigger(i); });
+		for (auto& p : producers)
+			p.join();
+		while (calls != static_cast<long>(perProducer) * aProducers)
+			std::this_thread::yield();
+		auto const elapsed = clock_type::now() - start;
+		std::cout << "cross-thread trigger, " << aProducers << " producer(s): " << 
+			1000.0 / ns_per(elapsed, perProducer * aProducers) << " M calls/s" << std::endl;
+		std::atomic<bool> unsubscribed = false;
+		task.post([&]() { s.clear(); unsubscribed = true; });
+		while (!unsubscribed)
+			std::this_thread::yield();
+	}
+
+	void async_latency()
+	{
+		neolib::async_task task{ "benchmark::consumer" };
+		task.set_reactor_mode(true);
+		neolib::async_thread thread{ task, "benchmark::consumer" };
+		thread.start();
+		neolib::event<clock_type::time_point> e;
+		neolib::sink s;
+		std::atomic<clock_type::time_point> received;
+		std::atomic<bool> subscribed = false;
+		task.post([&]() { s += e([&](clock_type::time_point) { received = clock_type::now(); }); subscribed = true; });
+		while (!subscribed)
+			std::this_thread::yield();
+		std::vector<clock_type::duration> samples;
+		for (int i = 0; i < 10000; ++i)
+		{
+			received = clock_type::time_point{};
+			auto const sent = clock_type::now();
+			e.trigger(sent);
+			while (received.load() == clock_type::time_point{})
+				std::this_thread::yield();
+			samples.push_back(received.load() - sent);
+		}
+		std::sort(samples.begin(), samples.end());
+		std::cout << "cross-thread latency: median " << ns_per(samples[samples.size() / 2], 1) << " ns, 99th percentile " << 
+			ns_per(samples[samples.size() * 99 / 100], 1) << " ns" << std::endl;
+		std::atomic<bool> unsubscribed = false;
+		task.post([&]() { s.clear(); unsubscribed = true; });
+		while (!unsubscribed)
+			std::this_thread::yield();
+	}
+
+	void churn()
+	{
+		neolib::event<int> e;
+		neolib::sink others;
+		for (int i = 0; i < 10; ++i)
+			others += e([](int) {});
+		std::size_t const iterations = 100000;
+		auto const start = clock_type::now();
+		for (std::size_t i = 0; i < iterations; ++i)
+		{
+			neolib::sink s;
+			s += e([](int) {});
+		}
+		auto const elapsed = clock_type::now() - start;
+		std::cout << "subscribe/unsubscribe (10 other slots): " << ns_per(elapsed, iterations) << " ns" << std::endl;
+	}
+
+	void trace_summary()
+	{
+		if constexpr (neolib::event_tracing::enabled)
+		{
+			auto const events = neolib::event_tracing::event_snapshot();
+			auto const queues = neolib::event_tracing::queue_snapshot();
+			std::cout << "tracing: " << events.size() << " event(s)" << std::endl;
+			for (auto const& [event, statistics] : events)
+				std::cout << "  " << event << ": " << statistics.syncTriggers << " sync, " << statistics.asyncTriggers << " async trigger(s), " <<
+					statistics.slotCalls << " slot call(s), " << statistics.queuedCalls << " queued call(s), " <<
+					std::chrono::duration_cast<std::chrono::microseconds>(statistics.dispatchTime).count() << " us" << std::endl;
+			std::cout << "  queues: " << queues.pumps << " pump(s), " << queues.calls << " call(s), " <<
+				std::chrono::duration_cast<std::chrono::microseconds>(queues.dispatchTime).count() << " us" << std::endl;
+		}
+	}
+}
+
+int main()
+{
+	neolib::allocate_service_provider();
+
+	for (std::size_t slots : { 1u, 10u, 100u })
+		sync_trigger(slots);
+	for (int producers : { 1, 4 })
+		async_throughput(producers);
+	async_latency();
+	churn();
+	trace_summary();
+}
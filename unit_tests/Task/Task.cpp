@@ -1,6 +1,16 @@
+#include <array>
+#include <numeric>
+#include <neolib/core/vector.hpp>
+#include <neolib/core/segmented_array.hpp>
+#include <neolib/core/hive.hpp>
+#include <neolib/core/gap_vector.hpp>
 #include <neolib/task/event.hpp>
 #include <neolib/task/async_thread.hpp>
 #include <neolib/task/timer.hpp>
+#include <neolib/task/parallel_algorithm.hpp>
+#include <neolib/task/task_future.hpp>
+#include <neolib/task/task_graph.hpp>
+#include <neolib/task/coroutine.hpp>
 #include <boost/signals2/signal.hpp>
 
 namespace test
@@ -22,6 +32,29 @@ namespace test
 		std::atomic<std::optional<std::chrono::steady_clock::time_point>> end;
 		std::optional<neolib::callback_timer> timer;
 	};
+
+	neolib::coroutine<int> square_later(neolib::thread_pool& aThreadPool, int aValue)
+	{
+		co_await neolib::resume_after(aThreadPool, std::chrono::milliseconds{ 1 });
+		co_return aValue * aValue;
+	}
+
+	neolib::coroutine<int> coroutine_steps(neolib::thread_pool& aThreadPool, neolib::i_async_task& aTask, neolib::event<int> const& aEvent, std::thread::id& aTaskThread)
+	{
+		co_await neolib::resume_on(aTask);
+		aTaskThread = std::this_thread::get_id();
+		co_await neolib::resume_after(aTask, std::chrono::milliseconds{ 5 });
+		int total = co_await square_later(aThreadPool, 3);
+		total += co_await neolib::launch(aThreadPool, []() { return 10; });
+		total += co_await neolib::next_event(aEvent);
+		co_return total;
+	}
+
+	neolib::coroutine<int> await_empty()
+	{
+		neolib::coroutine<int> empty;
+		co_return co_await empty;
+	}
 }
 
 template<> neolib::i_async_task& neolib::services::start_service<neolib::i_async_task>()
@@ -90,4 +123,380 @@ int main()
 	auto end2 = std::chrono::high_resolution_clock::now();
 	std::cout << "Boost.Signals2 emit rate: " << std::fixed << 
 		total2 / std::chrono::duration<double>(end2 - start2).count() << "/sec" << std::endl;
+
+	std::cout << std::endl;
+
+	neolib::thread_pool threadPool;
+	std::atomic<int> total3 = 0;
+	auto start3 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < 1000; ++i)
+		threadPool.run([&]()
+		{
+			for (int j = 0; j < 100; ++j)
+				threadPool.run([&]() { ++total3; });
+		});
+	threadPool.wait();
+	auto end3 = std::chrono::high_resolution_clock::now();
+	std::cout << "neolib thread_pool task rate: " << std::fixed <<
+		total3 / std::chrono::duration<double>(end3 - start3).count() << "/sec" << std::endl;
+	if (total3 != 100000)
+		throw std::logic_error("failed");
+
+	std::atomic<int> total4 = 0;
+	neolib::task_group outerGroup{ threadPool };
+	for (int i = 0; i < 100; ++i)
+		outerGroup.run([&]()
+		{
+			std::vector<int> v(100, 1);
+			neolib::parallel_apply(threadPool, v, [&](int& n) { total4 += n; });
+		});
+	outerGroup.wait();
+	std::cout << "neolib task_group nested total: " << total4 << std::endl;
+	if (total4 != 10000)
+		throw std::logic_error("failed");
+
+	{
+		neolib::thread_pool threadlessPool;
+		threadlessPool.reserve(0);
+		neolib::task_group threadlessGroup{ threadlessPool };
+		bool threw = false;
+		try { threadlessGroup.run([]() {}); } catch (neolib::thread_pool::no_threads const&) { threw = true; }
+		if (!threw || !threadlessGroup.done())
+			throw std::logic_error("failed");
+	}
+
+	std::atomic<int> total5 = 0;
+	std::array<char, 256> big = {};
+	auto start5 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < 1000; ++i)
+		threadPool.post([&]()
+		{
+			for (int j = 0; j < 100; ++j)
+				threadPool.post([&]() { ++total5; });
+		});
+	threadPool.post([&, big]() { total5 += big.size(); }); // too large for inline storage
+	threadPool.wait();
+	auto end5 = std::chrono::high_resolution_clock::now();
+	std::cout << "neolib thread_pool post rate: " << std::fixed <<
+		total5 / std::chrono::duration<double>(end5 - start5).count() << "/sec" << std::endl;
+	if (total5 != 100000 + 256)
+		throw std::logic_error("failed");
+
+	neolib::vector<int> pv;
+	neolib::segmented_array<int> psa;
+	neolib::hive<int> ph;
+	neolib::gap_vector<int> pgv;
+	for (int i = 0; i < 10000; ++i)
+	{
+		pv.push_back(10000 - i);
+		psa.push_back(10000 - i);
+		ph.insert(10000 - i);
+		pgv.push_back(10000 - i);
+	}
+	auto check_parallel_algorithms = [&](auto& aContainer)
+	{
+		neolib::parallel_for(threadPool, aContainer, [](int& n) { n *= 2; }, 100);
+		if (neolib::parallel_reduce(threadPool, aContainer, 0ll) != 10000ll * 10001ll)
+			throw std::logic_error("failed");
+		neolib::parallel_sort(threadPool, aContainer);
+		if (!std::is_sorted(aContainer.begin(), aContainer.end()))
+			throw std::logic_error("failed");
+		std::vector<int> transformed(aContainer.size());
+		neolib::parallel_transform(threadPool, aContainer, transformed.begin(), [](int n) { return n / 2; }, 64);
+		neolib::parallel_inclusive_scan(threadPool, transformed, transformed.begin(), std::plus<>{}, 64);
+		for (std::size_t i = 0; i < transformed.size(); ++i)
+			if (transformed[i] != static_cast<int>((i + 1) * (i + 2) / 2))
+				throw std::logic_error("failed");
+	};
+	check_parallel_algorithms(pv);
+	check_parallel_algorithms(psa);
+	check_parallel_algorithms(ph);
+	check_parallel_algorithms(pgv);
+	std::cout << "neolib parallel algorithms: OK" << std::endl;
+
+	neolib::thread_pool cappedPool;
+	cappedPool.reserve(4);
+	cappedPool.set_concurrency_limit(1, 1);
+	cappedPool.enable_aging(std::chrono::milliseconds{ 1 });
+	std::atomic<int> running = 0;
+	std::atomic<int> maxRunning = 0;
+	std::atomic<int> completed = 0;
+	for (int i = 0; i < 50; ++i)
+	{
+		cappedPool.post([&]()
+		{
+			auto const nowRunning = ++running;
+			for (auto previous = maxRunning.load(); previous < nowRunning && !maxRunning.compare_exchange_weak(previous, nowRunning););
+			std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+			--running;
+			++completed;
+		}, 1);
+		cappedPool.post([&]() { ++completed; }, i % 3 - 1);
+	}
+	cappedPool.wait();
+	std::cout << "neolib thread_pool capped priority concurrency: " << maxRunning << std::endl;
+	if (maxRunning != 1 || completed != 100 || cappedPool.concurrency_limit(1) != 1u || cappedPool.concurrency_limit(0))
+		throw std::logic_error("failed");
+
+	// more distinct priorities than there are priority levels: idle levels are reclaimed and the rest share the nearest level
+	std::atomic<int> prioritised = 0;
+	for (int i = 0; i < 1000; ++i)
+		cappedPool.post([&]() { ++prioritised; }, 100 + i);
+	cappedPool.wait();
+	if (prioritised != 1000 || cappedPool.concurrency_limit(1) != 1u)
+		throw std::logic_error("failed");
+
+	auto const lastCpu = neolib::cpu_count() - 1;
+	neolib::thread_pool pinnedPool;
+	pinnedPool.reserve(2);
+	pinnedPool.set_placement(neolib::thread_placement::on_cpus({ lastCpu }, true));
+	std::atomic<bool> wrongCpu = false;
+	for (int i = 0; i < 100; ++i)
+		pinnedPool.post([&]() { if (neolib::this_thread::current_cpu() && *neolib::this_thread::current_cpu() != lastCpu) wrongCpu = true; });
+	pinnedPool.wait();
+	auto const unreserved = neolib::thread_placement::any().excluding({ lastCpu });
+	if (wrongCpu || (neolib::cpu_count() > 1 && unreserved.cpus.size() != neolib::cpu_count() - 1) || neolib::numa_node_cpus(0).empty())
+		throw std::logic_error("failed");
+	std::cout << "neolib thread_pool placement: OK" << std::endl;
+
+	neolib::thread_pool elasticPool;
+	elasticPool.set_elastic(neolib::thread_pool::elastic_policy{ 1, 4, std::chrono::milliseconds{ 20 }, std::chrono::milliseconds{ 0 }, 1 });
+	for (int i = 0; i < 200; ++i)
+		elasticPool.post([]() { std::this_thread::sleep_for(std::chrono::microseconds{ 200 }); });
+	auto const grownThreads = elasticPool.total_threads();
+	elasticPool.wait();
+	for (int i = 0; i < 100 && elasticPool.total_threads() > 1; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+	std::cout << "neolib thread_pool elastic threads: " << grownThreads << " -> " << elasticPool.total_threads() << std::endl;
+	if (grownThreads <= 1 || elasticPool.total_threads() != 1)
+		throw std::logic_error("failed");
+
+	std::atomic<int> delayedRuns = 0;
+	std::atomic<int> periodicRuns = 0;
+	std::atomic<bool> delayedEarly = false;
+	auto const scheduleStart = std::chrono::steady_clock::now();
+	for (int i = 0; i < 10000; ++i)
+	{
+		auto const delay = std::chrono::milliseconds{ i % 50 };
+		threadPool.run_after(delay, [&, delay]()
+		{
+			if (std::chrono::steady_clock::now() - scheduleStart < delay)
+				delayedEarly = true;
+			++delayedRuns;
+		});
+	}
+	auto cancelled = threadPool.run_after(std::chrono::milliseconds{ 10 }, [&]() { delayedRuns += 1000000; });
+	cancelled->cancel();
+	auto periodic = threadPool.run_every(std::chrono::milliseconds{ 5 }, [&]() { ++periodicRuns; });
+	while (delayedRuns < 10000 || periodicRuns < 5)
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+	periodic->cancel();
+	auto const scheduleElapsed = std::chrono::steady_clock::now() - scheduleStart;
+	std::cout << "neolib thread_pool scheduled tasks: " << delayedRuns << " delayed, " << periodicRuns << " periodic in " <<
+		std::chrono::duration_cast<std::chrono::milliseconds>(scheduleElapsed).count() << "ms" << std::endl;
+	std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+	if (delayedRuns != 10000 || delayedEarly || threadPool.scheduled_tasks() != 0)
+		throw std::logic_error("failed");
+
+	auto chained = neolib::launch(threadPool, []() { return 20; }).then([](int aValue) { return aValue * 2; }).then([](int aValue) { return aValue + 2; });
+	auto failed = neolib::launch(threadPool, []() -> int { throw std::runtime_error("oops"); }).then([](int aValue) { return aValue; });
+	std::vector<neolib::task_future<int>> squares;
+	for (int i = 0; i < 10; ++i)
+		squares.push_back(neolib::launch(threadPool, [i]() { return i * i; }));
+	auto allSquares = neolib::when_all(squares);
+	auto both = neolib::when_all(chained, neolib::launch(threadPool, []() {}));
+	auto first = neolib::when_any(neolib::launch(threadPool, []() { std::this_thread::sleep_for(std::chrono::milliseconds{ 50 }); }), neolib::launch(threadPool, []() {}));
+	bool caught = false;
+	try { failed.get(); } catch (std::runtime_error const&) { caught = true; }
+	auto const squareSum = std::accumulate(allSquares.get().begin(), allSquares.get().end(), 0);
+	std::cout << "neolib task_future: " << chained.get() << ", " << squareSum << ", " << std::get<0>(both.get()) << ", " << first.get() << std::endl;
+	if (chained.get() != 42 || !caught || squareSum != 285 || first.get() != 1u)
+		throw std::logic_error("failed");
+
+	// diamond: a -> (b, c) -> d, re-run each "frame"
+	neolib::task_graph graph{ threadPool };
+	std::atomic<int> stage = 0;
+	std::atomic<bool> outOfOrder = false;
+	auto const a = graph.add_node([&]() { if (stage++ % 4 != 0) outOfOrder = true; });
+	auto const b = graph.add_node([&]() { if (stage++ % 4 == 0) outOfOrder = true; });
+	auto const c = graph.add_node([&]() { if (stage++ % 4 == 0) outOfOrder = true; });
+	auto const d = graph.add_node([&]() { if (stage++ % 4 != 3) outOfOrder = true; });
+	graph.add_edge(a, b);
+	graph.add_edge(a, c);
+	graph.add_edge(b, d);
+	graph.add_edge(c, d);
+	for (int frame = 0; frame < 1000; ++frame)
+		graph.run();
+	std::cout << "neolib task_graph: " << stage << " nodes run" << std::endl;
+	graph.add_edge(d, a);
+	bool cycle = false;
+	try { graph.run(); } catch (neolib::task_graph::cycle_detected const&) { cycle = true; }
+	if (outOfOrder || stage != 4000 || !cycle)
+		throw std::logic_error("failed");
+
+	{
+		test::thread coroutineThread;
+		neolib::event<int> coroutineEvent;
+		std::thread::id coroutineTaskThread;
+		auto coroutineResult = neolib::spawn(threadPool, test::coroutine_steps(threadPool, coroutineThread, coroutineEvent, coroutineTaskThread));
+		while (!coroutineEvent.has_slots())
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		coroutineEvent.trigger(100);
+		std::cout << "neolib coroutine: " << coroutineResult.get() << std::endl;
+		if (coroutineResult.get() != 119 || coroutineTaskThread != coroutineThread.id())
+			throw std::logic_error("failed");
+	}
+
+	{
+		neolib::thread_pool stoppedPool;
+		stoppedPool.stop();
+		bool threw = false;
+		try { neolib::spawn(threadPool, test::await_empty()).get(); } catch (neolib::coroutine<int>::empty_coroutine const&) { threw = true; }
+		if (neolib::spawn(threadPool, test::square_later(stoppedPool, 4)).get() != 16 || !threw)
+			throw std::logic_error("failed");
+	}
+
+	neolib::thread_pool instrumentedPool;
+	instrumentedPool.reserve(2);
+	instrumentedPool.enable_timing();
+	for (int i = 0; i < 1000; ++i)
+		instrumentedPool.post([&]() { for (int j = 0; j < 4; ++j) instrumentedPool.post([]() { std::this_thread::yield(); }); });
+	instrumentedPool.wait();
+	auto const poolStatistics = instrumentedPool.snapshot();
+	auto const startedTasks = std::accumulate(poolStatistics.startLatency.begin(), poolStatistics.startLatency.end(), std::uint64_t{});
+	auto const timedTasks = std::accumulate(poolStatistics.runTime.begin(), poolStatistics.runTime.end(), std::uint64_t{});
+	std::cout << "neolib thread_pool statistics: " << poolStatistics.tasksExecuted << " tasks, " << poolStatistics.steals << "/" << poolStatistics.stealAttempts << " steals, " <<
+		"median start latency < " << neolib::thread_pool::statistics::percentile(poolStatistics.startLatency, 0.5).count() << "ns, " <<
+		"99th percentile run time < " << neolib::thread_pool::statistics::percentile(poolStatistics.runTime, 0.99).count() << "ns" << std::endl;
+	if (poolStatistics.tasksExecuted != 5000 || startedTasks != 5000 || timedTasks != 5000 || poolStatistics.workers.size() != 2 || poolStatistics.steals > poolStatistics.stealAttempts)
+		throw std::logic_error("failed");
+
+	{
+		// a throwing task must not take its worker down or leave wait() hanging
+		neolib::thread_pool throwingPool;
+		throwingPool.reserve(1);
+		std::atomic<int> ranAfterThrow = 0;
+		throwingPool.post([]() { throw std::runtime_error("expected"); });
+		throwingPool.post([&]() { ++ranAfterThrow; });
+		throwingPool.wait();
+		if (ranAfterThrow != 1)
+			throw std::logic_error("failed");
+	}
+	instrumentedPool.reset_statistics();
+	if (instrumentedPool.snapshot().tasksExecuted != 0)
+		throw std::logic_error("failed");
+
+	{
+		neolib::async_task reactorTask{ "test::reactor" };
+		reactorTask.set_reactor_mode(true);
+		neolib::async_thread reactorThread{ reactorTask, "test::reactor" };
+		reactorThread.start();
+		std::optional<neolib::callback_timer> reactorTimer;
+		std::atomic<std::optional<std::chrono::steady_clock::time_point>> timerFired;
+		auto const timerStart = std::chrono::steady_clock::now();
+		reactorTask.post([&]() { reactorTimer.emplace(reactorTask, [&](neolib::callback_timer&) { timerFired = std::chrono::steady_clock::now(); }, std::chrono::milliseconds{ 20 }); });
+		std::chrono::steady_clock::duration worstHop{};
+		for (int i = 0; i < 100; ++i)
+		{
+			std::atomic<bool> hopped = false;
+			auto const hopStart = std::chrono::steady_clock::now();
+			reactorTask.post([&]() { hopped = true; });
+			while (!hopped)
+				std::this_thread::yield();
+			worstHop = std::max(worstHop, std::chrono::steady_clock::now() - hopStart);
+		}
+		auto const idleCpuStart = std::clock();
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+		auto const idleCpu = std::clock() - idleCpuStart;
+		while (timerFired.load() == std::nullopt)
+			std::this_thread::yield();
+		auto const timerLatency = *timerFired.load() - timerStart;
+		std::cout << "neolib async_task reactor: worst hop " << std::chrono::duration_cast<std::chrono::microseconds>(worstHop).count() << "us, " <<
+			"20ms timer fired after " << std::chrono::duration_cast<std::chrono::microseconds>(timerLatency).count() << "us, " <<
+			"idle CPU " << idleCpu * 1000 / CLOCKS_PER_SEC << "ms" << std::endl;
+		if (timerLatency < std::chrono::milliseconds{ 20 })
+			throw std::logic_error("failed");
+		reactorTask.post([&]() { reactorTimer.reset(); });
+		while (reactorTimer)
+			std::this_thread::yield();
+	}
+
+	{
+		neolib::async_task wheelTask{ "test::wheel" };
+		std::vector<std::unique_ptr<neolib::callback_timer>> wheelTimers;
+		std::size_t wheelFired = 0;
+		bool wheelEarly = false;
+		auto const wheelStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < 10000; ++i)
+		{
+			auto const duration = std::chrono::milliseconds{ 1 + (i * 7919) % 400 };
+			wheelTimers.push_back(std::make_unique<neolib::callback_timer>(wheelTask, [&, duration](neolib::callback_timer&)
+			{
+				wheelEarly = wheelEarly || std::chrono::steady_clock::now() - wheelStart < duration;
+				++wheelFired;
+			}, duration));
+		}
+		for (std::size_t i = 0; i < wheelTimers.size(); i += 4)
+			wheelTimers[i]->cancel();
+		for (std::size_t i = 0; i < wheelTimers.size(); i += 8)
+			wheelTimers[i] = nullptr;
+		while (wheelFired < 7500 && std::chrono::steady_clock::now() - wheelStart < std::chrono::seconds{ 10 })
+		{
+			wheelTask.timer_service().poll(false, 0);
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		}
+		std::cout << "neolib timer wheel: " << wheelFired << " timers fired" << std::endl;
+		if (wheelFired != 7500 || wheelEarly || wheelTask.timer_service().next_deadline() != std::nullopt)
+			throw std::logic_error("failed");
+
+		wheelTimers.clear();
+		wheelFired = 0;
+		auto const slackStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < 100; ++i)
+		{
+			auto const duration = std::chrono::milliseconds{ 100 + i / 2 };
+			wheelTimers.push_back(std::make_unique<neolib::callback_timer>(wheelTask, [&, duration](neolib::callback_timer&)
+			{
+				wheelEarly = wheelEarly || std::chrono::steady_clock::now() - slackStart < duration;
+				++wheelFired;
+			}, duration));
+			wheelTimers.back()->set_slack(std::chrono::milliseconds{ 100 });
+		}
+		std::size_t wakeUps = 0;
+		while (wheelFired < 100 && std::chrono::steady_clock::now() - slackStart < std::chrono::seconds{ 10 })
+		{
+			if (wheelTask.timer_service().poll(false, 0))
+				++wakeUps;
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		}
+		std::cout << "neolib timer slack: 100 timers expired in " << wakeUps << " wake-ups" << std::endl;
+		if (wheelFired != 100 || wheelEarly || wakeUps > 10)
+			throw std::logic_error("failed");
+	}
+
+	{
+		neolib::async_task messageTask{ "test::messages" };
+		auto& messages = messageTask.create_message_queue();
+		neolib::waitable_event signalled;
+		std::optional<neolib::wait_result> first;
+		std::optional<neolib::wait_result> second;
+		std::thread messageWaiter{ [&]()
+			{
+				first.emplace(neolib::waitable_event_list{ signalled }.msg_wait(messages));
+				second.emplace(neolib::waitable_event_list{ signalled }.msg_wait(messages));
+			} };
+		auto const waitCpuStart = std::clock();
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+		auto const waitCpu = std::clock() - waitCpuStart;
+		signalled.signal_one();
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+		messages.bump();
+		messageWaiter.join();
+		std::cout << "neolib message wait: idle CPU " << waitCpu * 1000 / CLOCKS_PER_SEC << "ms" << std::endl;
+		if (!std::holds_alternative<neolib::wait_result_event>(*first) || !std::holds_alternative<neolib::wait_result_message>(*second))
+			throw std::logic_error("failed");
+		messages.get_message();
+		if (messages.have_message())
+			throw std::logic_error("failed");
+	}
 }
\ No newline at end of file